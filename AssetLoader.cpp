@@ -0,0 +1,132 @@
+#include "AssetLoader.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+namespace gps {
+    AssetLoader::AssetLoader() {
+        pendingJobs = 0;
+        stopping = false;
+    }
+    AssetLoader::~AssetLoader() {
+        Finish();
+    }
+    void AssetLoader::Start(unsigned int threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        stopping = false;
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.push_back(std::thread(&AssetLoader::WorkerLoop, this));
+        }
+        std::cout << "Asset loader started with " << threadCount << " worker threads" << std::endl;
+    }
+    void AssetLoader::Submit(std::function<void()> job) {
+        if (workers.empty()) {
+            job();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+            pendingJobs++;
+        }
+        jobReady.notify_one();
+    }
+    void AssetLoader::QueueUpload(std::function<void()> upload) {
+        if (workers.empty()) {
+            upload();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uploads.push_back(upload);
+        }
+        uploadReady.notify_one();
+    }
+    void AssetLoader::Finish() {
+        if (workers.empty()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        while (pendingJobs > 0 || !uploads.empty()) {
+            uploadReady.wait(lock, [this] { return pendingJobs == 0 || !uploads.empty(); });
+            RunUploads(lock);
+        }
+        stopping = true;
+        lock.unlock();
+        jobReady.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+    }
+    void AssetLoader::RunUploads(std::unique_lock<std::mutex>& lock) {
+        while (!uploads.empty()) {
+            std::function<void()> upload = uploads.front();
+            uploads.pop_front();
+            lock.unlock();
+            upload();
+            lock.lock();
+        }
+    }
+    void AssetLoader::WorkerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            std::function<void()> job = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+            pendingJobs--;
+            if (pendingJobs == 0) {
+                uploadReady.notify_one();
+            }
+        }
+    }
+    static void FlipRows(DecodedImage& image) {
+        size_t rowBytes = (size_t)image.width * image.channels;
+        std::vector<unsigned char> row(rowBytes);
+        for (int y = 0; y < image.height / 2; y++) {
+            unsigned char* top = image.pixels + y * rowBytes;
+            unsigned char* bottom = image.pixels + (image.height - y - 1) * rowBytes;
+            memcpy(row.data(), top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+    bool AssetLoader::DecodeImage(const std::string& path, int desiredChannels, bool flipVertically, DecodedImage& image) {
+        int channels = 0;
+        image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, desiredChannels);
+        image.channels = desiredChannels != 0 ? desiredChannels : channels;
+        if (!image.pixels) {
+            return false;
+        }
+        if (flipVertically) {
+            FlipRows(image);
+        }
+        return true;
+    }
+    bool AssetLoader::DecodeImage(const unsigned char* data, size_t size, int desiredChannels, bool flipVertically, DecodedImage& image) {
+        int channels = 0;
+        image.pixels = stbi_load_from_memory(data, (int)size, &image.width, &image.height, &channels, desiredChannels);
+        image.channels = desiredChannels != 0 ? desiredChannels : channels;
+        if (!image.pixels) {
+            return false;
+        }
+        if (flipVertically) {
+            FlipRows(image);
+        }
+        return true;
+    }
+    void AssetLoader::FreeImage(DecodedImage& image) {
+        if (image.pixels) {
+            stbi_image_free(image.pixels);
+            image.pixels = NULL;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef AssetLoader_hpp
+#define AssetLoader_hpp
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+namespace gps {
+    struct DecodedImage {
+        int width;
+        int height;
+        int channels;
+        unsigned char* pixels;
+    };
+    class AssetLoader {
+    public:
+        AssetLoader();
+        ~AssetLoader();
+        void Start(unsigned int threadCount = 0);
+        void Submit(std::function<void()> job);
+        void QueueUpload(std::function<void()> upload);
+        void Finish();
+        static bool DecodeImage(const std::string& path, int desiredChannels, bool flipVertically, DecodedImage& image);
+        static bool DecodeImage(const unsigned char* data, size_t size, int desiredChannels, bool flipVertically, DecodedImage& image);
+        static void FreeImage(DecodedImage& image);
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()> > jobs;
+        std::deque<std::function<void()> > uploads;
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::condition_variable uploadReady;
+        int pendingJobs;
+        bool stopping;
+        void WorkerLoop();
+        void RunUploads(std::unique_lock<std::mutex>& lock);
+    };
+}
+#endif
@@ -0,0 +1,168 @@
+#include "AssetRegistry.hpp"
+#include "TextureCache.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+namespace gps {
+    std::unordered_map<std::string, std::weak_ptr<ModelResource> > AssetRegistry::models;
+    std::mutex AssetRegistry::textureMutex;
+    std::unordered_map<std::string, std::weak_ptr<TextureResource> > AssetRegistry::texturesByPath;
+    std::unordered_map<unsigned long long, std::weak_ptr<TextureResource> > AssetRegistry::texturesByContent;
+    static unsigned long long HashContent(const std::vector<unsigned char>& data) {
+        unsigned long long hash = 14695981039346656037ull;
+        for (size_t i = 0; i < data.size(); i++) {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash ^ (unsigned long long)data.size();
+    }
+    ModelResource::ModelResource() {
+        boundsMin = glm::vec3(0.0f);
+        boundsMax = glm::vec3(0.0f);
+        boundsCenter = glm::vec3(0.0f);
+        boundsRadius = 0.0f;
+        ready = false;
+        duplicates = 0;
+    }
+    std::string AssetRegistry::CanonicalPath(const std::string& path) {
+        std::string normalized = path;
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+#if defined(_WIN32)
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
+#endif
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= normalized.size()) {
+            size_t end = normalized.find('/', start);
+            if (end == std::string::npos) {
+                end = normalized.size();
+            }
+            std::string part = normalized.substr(start, end - start);
+            if (part == "..") {
+                if (!parts.empty() && parts.back() != "..") {
+                    parts.pop_back();
+                } else {
+                    parts.push_back(part);
+                }
+            } else if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            start = end + 1;
+        }
+        std::string canonical = (!normalized.empty() && normalized[0] == '/') ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++) {
+            if (i > 0) {
+                canonical += "/";
+            }
+            canonical += parts[i];
+        }
+        return canonical;
+    }
+    std::shared_ptr<ModelResource> AssetRegistry::AcquireModel(const std::string& path, bool& created) {
+        std::string key = CanonicalPath(path);
+        std::shared_ptr<ModelResource> model = models[key].lock();
+        created = !model;
+        if (model) {
+            model->duplicates++;
+            return model;
+        }
+        model = std::make_shared<ModelResource>();
+        model->path = key;
+        models[key] = model;
+        return model;
+    }
+    void AssetRegistry::WhenReady(std::shared_ptr<ModelResource> model, std::function<void()> callback) {
+        if (model->ready) {
+            callback();
+        } else {
+            model->onReady.push_back(callback);
+        }
+    }
+    void AssetRegistry::MarkReady(std::shared_ptr<ModelResource> model) {
+        model->ready = true;
+        std::vector<std::function<void()> > callbacks;
+        callbacks.swap(model->onReady);
+        for (size_t i = 0; i < callbacks.size(); i++) {
+            callbacks[i]();
+        }
+    }
+    TextureClaim AssetRegistry::ClaimTexture(const std::string& path) {
+        TextureClaim claim;
+        claim.load = false;
+        claim.contentHash = 0;
+        std::string key = CanonicalPath(path);
+        {
+            std::lock_guard<std::mutex> lock(textureMutex);
+            claim.resource = texturesByPath[key].lock();
+            if (claim.resource) {
+                claim.resource->duplicates++;
+                return claim;
+            }
+        }
+        if (!TextureCache::CachedContentHash(path, claim.contentHash) && ReadFile(path, claim.fileData)) {
+            claim.contentHash = HashContent(claim.fileData);
+        }
+        std::lock_guard<std::mutex> lock(textureMutex);
+        claim.resource = texturesByPath[key].lock();
+        if (!claim.resource && claim.contentHash != 0) {
+            claim.resource = texturesByContent[claim.contentHash].lock();
+            if (claim.resource) {
+                texturesByPath[key] = claim.resource;
+            }
+        }
+        if (claim.resource) {
+            claim.resource->duplicates++;
+            claim.fileData.clear();
+            return claim;
+        }
+        claim.resource = std::make_shared<TextureResource>();
+        claim.load = true;
+        texturesByPath[key] = claim.resource;
+        if (claim.contentHash != 0) {
+            texturesByContent[claim.contentHash] = claim.resource;
+        }
+        return claim;
+    }
+    bool AssetRegistry::ReadFile(const std::string& path, std::vector<unsigned char>& data) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !data.empty();
+    }
+    void AssetRegistry::LogStats() {
+        size_t modelCount = 0;
+        size_t modelBytes = 0;
+        size_t modelSaved = 0;
+        for (std::unordered_map<std::string, std::weak_ptr<ModelResource> >::iterator it = models.begin(); it != models.end(); ++it) {
+            std::shared_ptr<ModelResource> model = it->second.lock();
+            if (!model) {
+                continue;
+            }
+            size_t bytes = 0;
+            for (size_t i = 0; i < model->meshes.size(); i++) {
+                bytes += model->meshes[i].geometry->bytes;
+            }
+            modelCount++;
+            modelBytes += bytes;
+            modelSaved += bytes * model->duplicates;
+        }
+        size_t textureCount = 0;
+        size_t textureBytes = 0;
+        size_t textureSaved = 0;
+        std::lock_guard<std::mutex> lock(textureMutex);
+        for (std::unordered_map<unsigned long long, std::weak_ptr<TextureResource> >::iterator it = texturesByContent.begin(); it != texturesByContent.end(); ++it) {
+            std::shared_ptr<TextureResource> texture = it->second.lock();
+            if (!texture) {
+                continue;
+            }
+            textureCount++;
+            textureBytes += texture->bytes;
+            textureSaved += texture->bytes * texture->duplicates;
+        }
+        std::cout << "Asset registry: " << modelCount << " models (" << modelBytes / 1024 << " KB), "
+            << textureCount << " textures (" << textureBytes / 1024 << " KB), deduplication saved "
+            << modelSaved / 1024 << " KB of geometry and " << textureSaved / 1024 << " KB of textures" << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef AssetRegistry_hpp
+#define AssetRegistry_hpp
+#include "Mesh.hpp"
+#include "TriangleBvh.hpp"
+#include "ConvexHull.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+namespace gps {
+    struct MeshResource {
+        std::shared_ptr<MeshGeometry> geometry;
+        Material material;
+        std::vector<Texture> textures;
+    };
+    struct ModelResource {
+        std::string path;
+        std::vector<MeshResource> meshes;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        std::shared_ptr<TriangleBvh> collision;
+        std::shared_ptr<ConvexHull> hull;
+        bool ready;
+        int duplicates;
+        std::vector<std::function<void()> > onReady;
+        ModelResource();
+    };
+    struct TextureClaim {
+        std::shared_ptr<TextureResource> resource;
+        bool load;
+        unsigned long long contentHash;
+        std::vector<unsigned char> fileData;
+    };
+    class AssetRegistry {
+    public:
+        static std::string CanonicalPath(const std::string& path);
+        static std::shared_ptr<ModelResource> AcquireModel(const std::string& path, bool& created);
+        static void WhenReady(std::shared_ptr<ModelResource> model, std::function<void()> callback);
+        static void MarkReady(std::shared_ptr<ModelResource> model);
+        static TextureClaim ClaimTexture(const std::string& path);
+        static bool ReadFile(const std::string& path, std::vector<unsigned char>& data);
+        static void LogStats();
+    private:
+        static std::unordered_map<std::string, std::weak_ptr<ModelResource> > models;
+        static std::mutex textureMutex;
+        static std::unordered_map<std::string, std::weak_ptr<TextureResource> > texturesByPath;
+        static std::unordered_map<unsigned long long, std::weak_ptr<TextureResource> > texturesByContent;
+    };
+}
+#endif
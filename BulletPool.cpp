@@ -0,0 +1,45 @@
+#include "BulletPool.hpp"
+namespace gps {
+    void BulletPool::Add(glm::vec3 position, glm::vec3 velocity, float life) {
+        positions.push_back(position);
+        velocities.push_back(velocity);
+        lives.push_back(life);
+    }
+    void BulletPool::Remove(size_t index) {
+        size_t last = positions.size() - 1;
+        if (index != last) {
+            positions[index] = positions[last];
+            velocities[index] = velocities[last];
+            lives[index] = lives[last];
+        }
+        positions.pop_back();
+        velocities.pop_back();
+        lives.pop_back();
+    }
+    void BulletPool::Advance(float delta) {
+        size_t count = positions.size();
+        for (size_t i = 0; i < count; i++) {
+            positions[i] += velocities[i] * delta;
+        }
+        for (size_t i = 0; i < count; i++) {
+            lives[i] -= delta;
+        }
+    }
+    void BulletPool::Clear() {
+        positions.clear();
+        velocities.clear();
+        lives.clear();
+    }
+    size_t BulletPool::Size() const {
+        return positions.size();
+    }
+    const glm::vec3& BulletPool::Position(size_t index) const {
+        return positions[index];
+    }
+    const glm::vec3& BulletPool::Velocity(size_t index) const {
+        return velocities[index];
+    }
+    float BulletPool::Life(size_t index) const {
+        return lives[index];
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef BulletPool_hpp
+#define BulletPool_hpp
+#include <glm/glm.hpp>
+#include <vector>
+namespace gps {
+    class BulletPool {
+    public:
+        void Add(glm::vec3 position, glm::vec3 velocity, float life);
+        void Remove(size_t index);
+        void Advance(float delta);
+        void Clear();
+        size_t Size() const;
+        const glm::vec3& Position(size_t index) const;
+        const glm::vec3& Velocity(size_t index) const;
+        float Life(size_t index) const;
+    private:
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> velocities;
+        std::vector<float> lives;
+    };
+}
+#endif
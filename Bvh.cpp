@@ -0,0 +1,187 @@
+#include "Bvh.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+namespace gps {
+    float Bvh::SurfaceArea(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+        glm::vec3 extent = boundsMax - boundsMin;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+    void Bvh::Build(const std::vector<glm::vec3>& primitiveMin, const std::vector<glm::vec3>& primitiveMax,
+                    std::vector<gps::BvhNode>& nodes, std::vector<unsigned int>& order) {
+        size_t count = primitiveMin.size();
+        nodes.clear();
+        order.resize(count);
+        if (count == 0) {
+            return;
+        }
+        std::vector<glm::vec3> centroids(count);
+        for (size_t i = 0; i < count; i++) {
+            order[i] = (unsigned int)i;
+            centroids[i] = (primitiveMin[i] + primitiveMax[i]) * 0.5f;
+        }
+        nodes.reserve(count * 2);
+        BvhNode root;
+        root.leftFirst = 0;
+        root.count = (unsigned int)count;
+        nodes.push_back(root);
+        std::vector<unsigned int> pending;
+        std::vector<unsigned int> pendingDepth;
+        pending.push_back(0);
+        pendingDepth.push_back(0);
+        while (!pending.empty()) {
+            unsigned int nodeIndex = pending.back();
+            unsigned int depth = pendingDepth.back();
+            pending.pop_back();
+            pendingDepth.pop_back();
+            unsigned int first = nodes[nodeIndex].leftFirst;
+            unsigned int primitives = nodes[nodeIndex].count;
+            glm::vec3 boundsMin = primitiveMin[order[first]];
+            glm::vec3 boundsMax = primitiveMax[order[first]];
+            glm::vec3 centroidMin = centroids[order[first]];
+            glm::vec3 centroidMax = centroidMin;
+            for (unsigned int i = first + 1; i < first + primitives; i++) {
+                boundsMin = glm::min(boundsMin, primitiveMin[order[i]]);
+                boundsMax = glm::max(boundsMax, primitiveMax[order[i]]);
+                centroidMin = glm::min(centroidMin, centroids[order[i]]);
+                centroidMax = glm::max(centroidMax, centroids[order[i]]);
+            }
+            nodes[nodeIndex].boundsMin = boundsMin;
+            nodes[nodeIndex].boundsMax = boundsMax;
+            if (primitives <= 2 || depth >= MAX_DEPTH) {
+                continue;
+            }
+            int bestAxis = -1;
+            int bestSplit = 0;
+            float bestCost = FLT_MAX;
+            for (int axis = 0; axis < 3; axis++) {
+                float extent = centroidMax[axis] - centroidMin[axis];
+                if (extent <= 0.0f) {
+                    continue;
+                }
+                glm::vec3 binMin[BIN_COUNT];
+                glm::vec3 binMax[BIN_COUNT];
+                unsigned int binCount[BIN_COUNT];
+                for (int b = 0; b < BIN_COUNT; b++) {
+                    binMin[b] = glm::vec3(FLT_MAX);
+                    binMax[b] = glm::vec3(-FLT_MAX);
+                    binCount[b] = 0;
+                }
+                float binScale = BIN_COUNT / extent;
+                for (unsigned int i = first; i < first + primitives; i++) {
+                    int b = std::min(BIN_COUNT - 1, (int)((centroids[order[i]][axis] - centroidMin[axis]) * binScale));
+                    binMin[b] = glm::min(binMin[b], primitiveMin[order[i]]);
+                    binMax[b] = glm::max(binMax[b], primitiveMax[order[i]]);
+                    binCount[b]++;
+                }
+                float leftArea[BIN_COUNT - 1];
+                unsigned int leftCount[BIN_COUNT - 1];
+                glm::vec3 sweepMin = glm::vec3(FLT_MAX);
+                glm::vec3 sweepMax = glm::vec3(-FLT_MAX);
+                unsigned int sweepCount = 0;
+                for (int b = 0; b < BIN_COUNT - 1; b++) {
+                    sweepCount += binCount[b];
+                    if (binCount[b] > 0) {
+                        sweepMin = glm::min(sweepMin, binMin[b]);
+                        sweepMax = glm::max(sweepMax, binMax[b]);
+                    }
+                    leftCount[b] = sweepCount;
+                    leftArea[b] = sweepCount > 0 ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+                }
+                sweepMin = glm::vec3(FLT_MAX);
+                sweepMax = glm::vec3(-FLT_MAX);
+                sweepCount = 0;
+                for (int b = BIN_COUNT - 1; b > 0; b--) {
+                    sweepCount += binCount[b];
+                    if (binCount[b] > 0) {
+                        sweepMin = glm::min(sweepMin, binMin[b]);
+                        sweepMax = glm::max(sweepMax, binMax[b]);
+                    }
+                    if (sweepCount == 0 || leftCount[b - 1] == 0) {
+                        continue;
+                    }
+                    float cost = leftCount[b - 1] * leftArea[b - 1] + sweepCount * SurfaceArea(sweepMin, sweepMax);
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+            float leafCost = primitives * SurfaceArea(boundsMin, boundsMax);
+            if (bestAxis < 0 || (bestCost >= leafCost && primitives <= MAX_LEAF_SIZE)) {
+                continue;
+            }
+            float binScale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+            unsigned int* begin = order.data() + first;
+            unsigned int* middle = std::partition(begin, begin + primitives, [&](unsigned int primitive) {
+                return std::min(BIN_COUNT - 1, (int)((centroids[primitive][bestAxis] - centroidMin[bestAxis]) * binScale)) < bestSplit;
+            });
+            unsigned int leftPrimitives = (unsigned int)(middle - begin);
+            if (leftPrimitives == 0 || leftPrimitives == primitives) {
+                continue;
+            }
+            unsigned int leftChild = (unsigned int)nodes.size();
+            BvhNode left;
+            left.leftFirst = first;
+            left.count = leftPrimitives;
+            BvhNode right;
+            right.leftFirst = first + leftPrimitives;
+            right.count = primitives - leftPrimitives;
+            nodes.push_back(left);
+            nodes.push_back(right);
+            nodes[nodeIndex].leftFirst = leftChild;
+            nodes[nodeIndex].count = 0;
+            pending.push_back(leftChild);
+            pending.push_back(leftChild + 1);
+            pendingDepth.push_back(depth + 1);
+            pendingDepth.push_back(depth + 1);
+        }
+    }
+    gps::BvhRay Bvh::PrepareRay(glm::vec3 origin, glm::vec3 direction) {
+        glm::vec3 inverse;
+        for (int axis = 0; axis < 3; axis++) {
+            float component = direction[axis];
+            if (std::abs(component) < 1e-20f) {
+                component = component < 0.0f ? -1e-20f : 1e-20f;
+            }
+            inverse[axis] = 1.0f / component;
+        }
+        BvhRay ray;
+#if defined (BVH_SSE)
+        ray.origin = _mm_set_ps(0.0f, origin.z, origin.y, origin.x);
+        ray.inverseDirection = _mm_set_ps(0.0f, inverse.z, inverse.y, inverse.x);
+#else
+        ray.origin = origin;
+        ray.inverseDirection = inverse;
+#endif
+        return ray;
+    }
+    float Bvh::IntersectBox(const gps::BvhRay& ray, const gps::BvhNode& node, float maxDistance) {
+#if defined (BVH_SSE)
+        __m128 boundsMin = _mm_set_ps(0.0f, node.boundsMin.z, node.boundsMin.y, node.boundsMin.x);
+        __m128 boundsMax = _mm_set_ps(0.0f, node.boundsMax.z, node.boundsMax.y, node.boundsMax.x);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(boundsMin, ray.origin), ray.inverseDirection);
+        __m128 t2 = _mm_mul_ps(_mm_sub_ps(boundsMax, ray.origin), ray.inverseDirection);
+        __m128 nearT = _mm_min_ps(t1, t2);
+        __m128 farT = _mm_max_ps(t1, t2);
+        nearT = _mm_max_ps(nearT, _mm_shuffle_ps(nearT, nearT, _MM_SHUFFLE(1, 0, 2, 1)));
+        nearT = _mm_max_ps(nearT, _mm_shuffle_ps(nearT, nearT, _MM_SHUFFLE(2, 1, 0, 2)));
+        farT = _mm_min_ps(farT, _mm_shuffle_ps(farT, farT, _MM_SHUFFLE(1, 0, 2, 1)));
+        farT = _mm_min_ps(farT, _mm_shuffle_ps(farT, farT, _MM_SHUFFLE(2, 1, 0, 2)));
+        float tNear = _mm_cvtss_f32(nearT);
+        float tFar = _mm_cvtss_f32(farT);
+#else
+        glm::vec3 t1 = (node.boundsMin - ray.origin) * ray.inverseDirection;
+        glm::vec3 t2 = (node.boundsMax - ray.origin) * ray.inverseDirection;
+        glm::vec3 nearT = glm::min(t1, t2);
+        glm::vec3 farT = glm::max(t1, t2);
+        float tNear = std::max(std::max(nearT.x, nearT.y), nearT.z);
+        float tFar = std::min(std::min(farT.x, farT.y), farT.z);
+#endif
+        if (tFar < std::max(tNear, 0.0f) || tNear > maxDistance) {
+            return FLT_MAX;
+        }
+        return tNear;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef Bvh_hpp
+#define Bvh_hpp
+#include <glm/glm.hpp>
+#include <vector>
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define BVH_SSE
+    #include <xmmintrin.h>
+#endif
+namespace gps {
+    struct BvhNode {
+        glm::vec3 boundsMin;
+        unsigned int leftFirst;
+        glm::vec3 boundsMax;
+        unsigned int count;
+    };
+    struct BvhRay {
+#if defined (BVH_SSE)
+        __m128 origin;
+        __m128 inverseDirection;
+#else
+        glm::vec3 origin;
+        glm::vec3 inverseDirection;
+#endif
+    };
+    class Bvh {
+    public:
+        static const int BIN_COUNT = 12;
+        static const unsigned int MAX_LEAF_SIZE = 8;
+        static const int STACK_SIZE = 64;
+        static const unsigned int MAX_DEPTH = STACK_SIZE - 1;
+        static void Build(const std::vector<glm::vec3>& primitiveMin, const std::vector<glm::vec3>& primitiveMax,
+                          std::vector<gps::BvhNode>& nodes, std::vector<unsigned int>& order);
+        static gps::BvhRay PrepareRay(glm::vec3 origin, glm::vec3 direction);
+        static float IntersectBox(const gps::BvhRay& ray, const gps::BvhNode& node, float maxDistance);
+    private:
+        static float SurfaceArea(glm::vec3 boundsMin, glm::vec3 boundsMax);
+    };
+}
+#endif
@@ -0,0 +1,85 @@
+#include "ConvexHull.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+namespace gps {
+    void ConvexHull::Build(const std::vector<glm::vec3>& positions) {
+        vertices.clear();
+        if (positions.empty()) {
+            return;
+        }
+        boundsMin = positions[0];
+        boundsMax = positions[0];
+        for (size_t i = 1; i < positions.size(); i++) {
+            boundsMin = glm::min(boundsMin, positions[i]);
+            boundsMax = glm::max(boundsMax, positions[i]);
+        }
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+        std::vector<size_t> extremes;
+        float goldenAngle = 3.14159265f * (3.0f - std::sqrt(5.0f));
+        for (int d = 0; d < SAMPLE_DIRECTIONS; d++) {
+            float y = 1.0f - 2.0f * (d + 0.5f) / SAMPLE_DIRECTIONS;
+            float ring = std::sqrt(1.0f - y * y);
+            float angle = goldenAngle * d;
+            glm::vec3 direction = glm::vec3(std::cos(angle) * ring, y, std::sin(angle) * ring) / extent;
+            size_t best = 0;
+            float bestDistance = -FLT_MAX;
+            for (size_t i = 0; i < positions.size(); i++) {
+                float distance = glm::dot(positions[i] - center, direction);
+                if (distance > bestDistance) {
+                    bestDistance = distance;
+                    best = i;
+                }
+            }
+            extremes.push_back(best);
+        }
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 direction = glm::vec3((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f) / extent;
+            size_t best = 0;
+            float bestDistance = -FLT_MAX;
+            for (size_t i = 0; i < positions.size(); i++) {
+                float distance = glm::dot(positions[i] - center, direction);
+                if (distance > bestDistance) {
+                    bestDistance = distance;
+                    best = i;
+                }
+            }
+            extremes.push_back(best);
+        }
+        std::sort(extremes.begin(), extremes.end());
+        extremes.erase(std::unique(extremes.begin(), extremes.end()), extremes.end());
+        for (size_t i = 0; i < extremes.size(); i++) {
+            vertices.push_back(positions[extremes[i]]);
+        }
+    }
+    void ConvexHull::Load(const glm::vec3* points, size_t count, glm::vec3 pointsMin, glm::vec3 pointsMax) {
+        vertices.assign(points, points + count);
+        boundsMin = pointsMin;
+        boundsMax = pointsMax;
+    }
+    glm::vec3 ConvexHull::Support(glm::vec3 direction) const {
+        size_t best = 0;
+        float bestDistance = -FLT_MAX;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            float distance = glm::dot(vertices[i], direction);
+            if (distance > bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return vertices.empty() ? glm::vec3(0.0f) : vertices[best];
+    }
+    glm::vec3 ConvexHull::BoundsMin() const {
+        return boundsMin;
+    }
+    glm::vec3 ConvexHull::BoundsMax() const {
+        return boundsMax;
+    }
+    size_t ConvexHull::VertexCount() const {
+        return vertices.size();
+    }
+    const std::vector<glm::vec3>& ConvexHull::Vertices() const {
+        return vertices;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef ConvexHull_hpp
+#define ConvexHull_hpp
+#include <glm/glm.hpp>
+#include <vector>
+namespace gps {
+    class ConvexHull {
+    public:
+        static const int SAMPLE_DIRECTIONS = 64;
+        void Build(const std::vector<glm::vec3>& positions);
+        void Load(const glm::vec3* points, size_t count, glm::vec3 pointsMin, glm::vec3 pointsMax);
+        glm::vec3 Support(glm::vec3 direction) const;
+        glm::vec3 BoundsMin() const;
+        glm::vec3 BoundsMax() const;
+        size_t VertexCount() const;
+        const std::vector<glm::vec3>& Vertices() const;
+    private:
+        std::vector<glm::vec3> vertices;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+}
+#endif
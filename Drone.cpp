@@ -1,9 +1,14 @@
 #include "Drone.hpp"
 #include "World.hpp" 
 #include <iostream>
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 namespace gps {
+    const float DRONE_RADIUS = 0.5f;
+    const float CONTACT_SKIN = 0.01f;
+    const float CRASH_SPEED = 50.0f;
+    const int SLIDE_ITERATIONS = 3;
     Drone::Drone() {
         position = glm::vec3(0.0f, 2.0f, 0.0f); 
         yaw = 0.0f;
@@ -19,8 +24,8 @@ namespace gps {
         rollLerpSpeed = 4.0f;
         turnFactor = 60.0f;
     }
-    void Drone::Load(std::string modelPath) {
-        mesh.LoadModel(modelPath);
+    void Drone::Load(std::string modelPath, gps::AssetLoader& loader) {
+        mesh.LoadModel(modelPath, loader);
     }
     void Drone::Update(float delta, GLboolean pressedKeys[], World& world) {
         if (isCrashed) {
@@ -90,17 +95,25 @@ namespace gps {
         if (pressedKeys[GLFW_KEY_S]) {
             proposedMove -= fwd * moveS;
         }
-        glm::vec3 nextPos = position + proposedMove;
-        bool collision = world.CheckCollision(nextPos, 0.5f);
-        if (!collision) {
-             collision = world.CheckCollision(position, 0.5f);
-        }
-        if (!collision) {
-             position = nextPos;
-        } else {
-             isCrashed = true;
-             verticalVelocity = 0.0f; 
-             position -= proposedMove * 2.0f; 
+        glm::vec3 move = proposedMove;
+        for (int iteration = 0; iteration < SLIDE_ITERATIONS; iteration++) {
+            SweepHit hit;
+            if (!world.SweepSphere(position, move, DRONE_RADIUS, hit)) {
+                position += move;
+                break;
+            }
+            position = hit.position + hit.normal * CONTACT_SKIN;
+            float approach = -glm::dot(move, hit.normal);
+            if (iteration == 0 && approach > CRASH_SPEED * delta) {
+                isCrashed = true;
+                verticalVelocity = 0.0f;
+                break;
+            }
+            glm::vec3 remaining = move * (1.0f - hit.time);
+            move = remaining - hit.normal * std::min(glm::dot(remaining, hit.normal), 0.0f);
+            if (glm::dot(move, move) < 1e-8f) {
+                break;
+            }
         }
         visualTilt += (targetVisualTilt - visualTilt) * tiltSpeed * delta;
         if(position.y < 2.0f) position.y = 2.0f;
@@ -115,11 +128,9 @@ namespace gps {
         model = glm::rotate(model, glm::radians(visualTilt), glm::vec3(1, 0, 0));
         model = glm::scale(model, glm::vec3(0.005f)); 
         model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1, 0, 0));
-        GLint modelLoc = glGetUniformLocation(shader.shaderProgram, "model");
-        GLint normalMatrixLoc = glGetUniformLocation(shader.shaderProgram, "normalMatrix");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        shader.setMat4(gps::Shader::UNIFORM_MODEL, model);
         glm::mat3 normMat = glm::mat3(glm::inverseTranspose(viewMatrix * model));
-        glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normMat));
+        shader.setMat3(gps::Shader::UNIFORM_NORMAL_MATRIX, normMat);
         for(size_t i=0; i<mesh.meshes.size(); ++i) {
             glm::vec3 originalKd = mesh.meshes[i].Kd;
             float brightness = (originalKd.r + originalKd.g + originalKd.b) / 3.0f;
@@ -10,7 +10,7 @@ namespace gps {
     class Drone {
     public:
         Drone();
-        void Load(std::string modelPath);
+        void Load(std::string modelPath, gps::AssetLoader& loader);
         void Update(float delta, GLboolean pressedKeys[], class World& world);
         void Draw(gps::Shader& shader, glm::mat4 viewMatrix);
         glm::vec3 GetPosition() const;
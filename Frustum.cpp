@@ -0,0 +1,34 @@
+#include "Frustum.hpp"
+namespace gps {
+    void Frustum::Extract(glm::mat4 viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+        planes[PLANE_LEFT] = rows[3] + rows[0];
+        planes[PLANE_RIGHT] = rows[3] - rows[0];
+        planes[PLANE_BOTTOM] = rows[3] + rows[1];
+        planes[PLANE_TOP] = rows[3] - rows[1];
+        planes[PLANE_NEAR] = rows[3] + rows[2];
+        planes[PLANE_FAR] = rows[3] - rows[2];
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            float length = glm::length(glm::vec3(planes[i]));
+            planes[i] = planes[i] / length;
+        }
+    }
+    void Frustum::ExtractShadowCasterVolume(glm::mat4 lightViewProjection) {
+        Extract(lightViewProjection);
+        planes[PLANE_NEAR] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    bool Frustum::IntersectsSphere(glm::vec3 center, float radius) const {
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+    glm::vec4 Frustum::GetPlane(int plane) const {
+        return planes[plane];
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+#include <glm/glm.hpp>
+namespace gps {
+    struct CullStats {
+        int visible;
+        int culled;
+    };
+    class Frustum {
+    public:
+        enum Plane {
+            PLANE_LEFT,
+            PLANE_RIGHT,
+            PLANE_BOTTOM,
+            PLANE_TOP,
+            PLANE_NEAR,
+            PLANE_FAR,
+            PLANE_COUNT
+        };
+        void Extract(glm::mat4 viewProjection);
+        void ExtractShadowCasterVolume(glm::mat4 lightViewProjection);
+        bool IntersectsSphere(glm::vec3 center, float radius) const;
+        glm::vec4 GetPlane(int plane) const;
+    private:
+        glm::vec4 planes[PLANE_COUNT];
+    };
+}
+#endif
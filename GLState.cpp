@@ -0,0 +1,102 @@
+#include "GLState.hpp"
+namespace gps {
+    GLuint GLState::currentProgram = 0;
+    GLuint GLState::currentVertexArray = 0;
+    GLuint GLState::activeUnit = 0;
+    GLuint GLState::boundTextures2D[GLState::MAX_TEXTURE_UNITS] = {0};
+    GLuint GLState::boundCubeMaps[GLState::MAX_TEXTURE_UNITS] = {0};
+    std::unordered_map<unsigned long long, GLint> GLState::samplerValues;
+    GLStateStats GLState::stats = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+    void GLState::UseProgram(GLuint program) {
+        if (program == currentProgram) {
+            stats.program.elided++;
+            return;
+        }
+        glUseProgram(program);
+        currentProgram = program;
+        stats.program.issued++;
+    }
+    void GLState::BindVertexArray(GLuint vertexArray) {
+        if (vertexArray == currentVertexArray) {
+            stats.vertexArray.elided++;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        currentVertexArray = vertexArray;
+        stats.vertexArray.issued++;
+    }
+    void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+        GLuint* bound = (target == GL_TEXTURE_CUBE_MAP) ? boundCubeMaps : boundTextures2D;
+        if (unit < MAX_TEXTURE_UNITS && bound[unit] == texture) {
+            stats.texture.elided++;
+            return;
+        }
+        if (unit != activeUnit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        glBindTexture(target, texture);
+        if (unit < MAX_TEXTURE_UNITS) {
+            bound[unit] = texture;
+        }
+        stats.texture.issued++;
+    }
+    void GLState::SetSampler(GLuint program, GLint location, GLint unit) {
+        if (location < 0) {
+            return;
+        }
+        unsigned long long key = ((unsigned long long)program << 32) | (unsigned int)location;
+        std::unordered_map<unsigned long long, GLint>::iterator it = samplerValues.find(key);
+        if (it != samplerValues.end() && it->second == unit) {
+            stats.sampler.elided++;
+            return;
+        }
+        glUniform1i(location, unit);
+        samplerValues[key] = unit;
+        stats.sampler.issued++;
+    }
+    void GLState::DeleteTextures(GLsizei count, const GLuint* textures) {
+        for (GLsizei t = 0; t < count; t++) {
+            for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+                if (boundTextures2D[i] == textures[t]) {
+                    boundTextures2D[i] = UNKNOWN;
+                }
+                if (boundCubeMaps[i] == textures[t]) {
+                    boundCubeMaps[i] = UNKNOWN;
+                }
+            }
+        }
+        glDeleteTextures(count, textures);
+    }
+    void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays) {
+        for (GLsizei v = 0; v < count; v++) {
+            if (currentVertexArray == vertexArrays[v]) {
+                currentVertexArray = UNKNOWN;
+            }
+        }
+        glDeleteVertexArrays(count, vertexArrays);
+    }
+    void GLState::Invalidate() {
+        currentProgram = UNKNOWN;
+        currentVertexArray = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            boundTextures2D[i] = UNKNOWN;
+            boundCubeMaps[i] = UNKNOWN;
+        }
+        samplerValues.clear();
+    }
+    GLStateStats GLState::GetStats() {
+        return stats;
+    }
+    void GLState::ResetStats() {
+        stats.program.issued = 0;
+        stats.program.elided = 0;
+        stats.vertexArray.issued = 0;
+        stats.vertexArray.elided = 0;
+        stats.texture.issued = 0;
+        stats.texture.elided = 0;
+        stats.sampler.issued = 0;
+        stats.sampler.elided = 0;
+    }
+}
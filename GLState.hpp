@@ -0,0 +1,45 @@
+#ifndef GLState_hpp
+#define GLState_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include <unordered_map>
+namespace gps {
+    struct BindCounter {
+        int issued;
+        int elided;
+    };
+    struct GLStateStats {
+        BindCounter program;
+        BindCounter vertexArray;
+        BindCounter texture;
+        BindCounter sampler;
+    };
+    class GLState {
+    public:
+        static const int MAX_TEXTURE_UNITS = 16;
+        static const GLuint UNKNOWN = 0xFFFFFFFFu;
+        static void UseProgram(GLuint program);
+        static void BindVertexArray(GLuint vertexArray);
+        static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+        static void SetSampler(GLuint program, GLint location, GLint unit);
+        static void DeleteTextures(GLsizei count, const GLuint* textures);
+        static void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+        static void Invalidate();
+        static GLStateStats GetStats();
+        static void ResetStats();
+    private:
+        static GLuint currentProgram;
+        static GLuint currentVertexArray;
+        static GLuint activeUnit;
+        static GLuint boundTextures2D[MAX_TEXTURE_UNITS];
+        static GLuint boundCubeMaps[MAX_TEXTURE_UNITS];
+        static std::unordered_map<unsigned long long, GLint> samplerValues;
+        static GLStateStats stats;
+    };
+}
+#endif
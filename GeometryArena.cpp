@@ -0,0 +1,201 @@
+#include "GeometryArena.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+namespace gps {
+    GeometryArena& GeometryArena::Get(Format format) {
+        static GeometryArena* arenas[FORMAT_COUNT] = { new GeometryArena(FORMAT_FLOAT), new GeometryArena(FORMAT_COMPACT) };
+        return *arenas[format];
+    }
+    GeometryArena::GeometryArena(Format format) {
+        this->format = format;
+        stride = format == FORMAT_COMPACT ? (GLsizei)sizeof(CompactVertex) : (GLsizei)sizeof(Vertex);
+        vertexArray = 0;
+        vertexBuffer = 0;
+        indexBuffer = 0;
+        vertexCapacity = 0;
+        indexCapacity = 0;
+        usedVertices = 0;
+        usedIndices = 0;
+        instanceBuffer = 0;
+    }
+    void GeometryArena::ForgetInstanceBuffer(GLuint instanceBuffer) {
+        for (int f = 0; f < FORMAT_COUNT; f++) {
+            GeometryArena& arena = Get((Format)f);
+            if (arena.instanceBuffer == instanceBuffer) {
+                arena.instanceBuffer = GLState::UNKNOWN;
+            }
+        }
+    }
+    void GeometryArena::LogStats() {
+        const char* names[FORMAT_COUNT] = { "float", "compact" };
+        for (int f = 0; f < FORMAT_COUNT; f++) {
+            GeometryArena& arena = Get((Format)f);
+            if (arena.vertexArray == 0) {
+                continue;
+            }
+            std::cout << "Geometry arena (" << names[f] << "): " << arena.usedVertices << "/" << arena.vertexCapacity << " vertices, "
+                      << arena.usedIndices << "/" << arena.indexCapacity << " indices, "
+                      << (arena.vertexCapacity * arena.stride + arena.indexCapacity * sizeof(GLuint)) / 1024 << " KB" << std::endl;
+        }
+    }
+    void GeometryArena::Create() {
+        vertexCapacity = INITIAL_VERTICES;
+        indexCapacity = INITIAL_INDICES;
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        ArenaRange vertices = { 0, vertexCapacity };
+        ArenaRange indices = { 0, indexCapacity };
+        freeVertices.push_back(vertices);
+        freeIndices.push_back(indices);
+        glGenVertexArrays(1, &vertexArray);
+        SetupVertexArray();
+    }
+    void GeometryArena::SetupVertexArray() {
+        GLState::BindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        if (format == FORMAT_COMPACT) {
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (GLvoid*)offsetof(CompactVertex, Position));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (GLvoid*)offsetof(CompactVertex, Normal));
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(CompactVertex, TexCoords));
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(Vertex, Position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(Vertex, Normal));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(Vertex, TexCoords));
+        }
+        for (GLuint attribute = 3; attribute < 8; attribute++) {
+            glVertexAttribDivisor(attribute, 1);
+        }
+        instanceBuffer = GLState::UNKNOWN;
+    }
+    GLuint GeometryArena::GrowBuffer(GLuint buffer, size_t oldBytes, size_t newBytes) {
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        return grown;
+    }
+    bool GeometryArena::TakeRange(std::vector<ArenaRange>& freeList, size_t count, size_t& offset) {
+        for (size_t i = 0; i < freeList.size(); i++) {
+            if (freeList[i].count >= count) {
+                offset = freeList[i].offset;
+                freeList[i].offset += count;
+                freeList[i].count -= count;
+                if (freeList[i].count == 0) {
+                    freeList.erase(freeList.begin() + i);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+    void GeometryArena::ReleaseRange(std::vector<ArenaRange>& freeList, size_t offset, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        ArenaRange range = { offset, count };
+        std::vector<ArenaRange>::iterator it = std::lower_bound(freeList.begin(), freeList.end(), range, [](const ArenaRange& a, const ArenaRange& b) {
+            return a.offset < b.offset;
+        });
+        it = freeList.insert(it, range);
+        std::vector<ArenaRange>::iterator next = it + 1;
+        if (next != freeList.end() && it->offset + it->count == next->offset) {
+            it->count += next->count;
+            freeList.erase(next);
+        }
+        if (it != freeList.begin()) {
+            std::vector<ArenaRange>::iterator previous = it - 1;
+            if (previous->offset + previous->count == it->offset) {
+                previous->count += it->count;
+                freeList.erase(it);
+            }
+        }
+    }
+    void GeometryArena::Allocate(size_t vertexCount, size_t indexCount, GLint& baseVertex, GLuint& firstIndex) {
+        if (vertexArray == 0) {
+            Create();
+        }
+        size_t vertexOffset = 0;
+        if (!TakeRange(freeVertices, vertexCount, vertexOffset)) {
+            size_t capacity = std::max(vertexCapacity * 2, vertexCapacity + vertexCount);
+            vertexBuffer = GrowBuffer(vertexBuffer, vertexCapacity * stride, capacity * stride);
+            ReleaseRange(freeVertices, vertexCapacity, capacity - vertexCapacity);
+            vertexCapacity = capacity;
+            SetupVertexArray();
+            TakeRange(freeVertices, vertexCount, vertexOffset);
+        }
+        size_t indexOffset = 0;
+        if (!TakeRange(freeIndices, indexCount, indexOffset)) {
+            size_t capacity = std::max(indexCapacity * 2, indexCapacity + indexCount);
+            indexBuffer = GrowBuffer(indexBuffer, indexCapacity * sizeof(GLuint), capacity * sizeof(GLuint));
+            ReleaseRange(freeIndices, indexCapacity, capacity - indexCapacity);
+            indexCapacity = capacity;
+            SetupVertexArray();
+            TakeRange(freeIndices, indexCount, indexOffset);
+        }
+        usedVertices += vertexCount;
+        usedIndices += indexCount;
+        baseVertex = (GLint)vertexOffset;
+        firstIndex = (GLuint)indexOffset;
+    }
+    void GeometryArena::Free(GLint baseVertex, size_t vertexCount, GLuint firstIndex, size_t indexCount) {
+        ReleaseRange(freeVertices, (size_t)baseVertex, vertexCount);
+        ReleaseRange(freeIndices, (size_t)firstIndex, indexCount);
+        usedVertices -= vertexCount;
+        usedIndices -= indexCount;
+    }
+    void GeometryArena::UploadVertices(GLint baseVertex, const void* data, size_t vertexCount) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)baseVertex * stride, vertexCount * stride, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    void GeometryArena::UploadIndices(GLuint firstIndex, const GLuint* data, size_t indexCount) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    void GeometryArena::BindInstances(GLuint instanceBuffer) {
+        GLState::BindVertexArray(vertexArray);
+        if (instanceBuffer == this->instanceBuffer) {
+            return;
+        }
+        if (instanceBuffer == 0) {
+            for (GLuint attribute = 3; attribute < 8; attribute++) {
+                glDisableVertexAttribArray(attribute);
+            }
+        } else {
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            for (GLuint column = 0; column < 4; column++) {
+                glEnableVertexAttribArray(3 + column);
+                glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+            }
+            glEnableVertexAttribArray(7);
+            glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid*)offsetof(InstanceData, color));
+        }
+        this->instanceBuffer = instanceBuffer;
+    }
+    GLuint GeometryArena::VertexArray() const {
+        return vertexArray;
+    }
+    GLuint GeometryArena::VertexBuffer() const {
+        return vertexBuffer;
+    }
+    GLuint GeometryArena::IndexBuffer() const {
+        return indexBuffer;
+    }
+}
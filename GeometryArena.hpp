@@ -0,0 +1,60 @@
+#ifndef GeometryArena_hpp
+#define GeometryArena_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include "Mesh.hpp"
+#include <vector>
+namespace gps {
+    struct ArenaRange {
+        size_t offset;
+        size_t count;
+    };
+    class GeometryArena {
+    public:
+        enum Format {
+            FORMAT_FLOAT,
+            FORMAT_COMPACT,
+            FORMAT_COUNT
+        };
+        static const size_t INITIAL_VERTICES = 256 * 1024;
+        static const size_t INITIAL_INDICES = 1024 * 1024;
+        static GeometryArena& Get(Format format);
+        static void ForgetInstanceBuffer(GLuint instanceBuffer);
+        static void LogStats();
+        void Allocate(size_t vertexCount, size_t indexCount, GLint& baseVertex, GLuint& firstIndex);
+        void Free(GLint baseVertex, size_t vertexCount, GLuint firstIndex, size_t indexCount);
+        void UploadVertices(GLint baseVertex, const void* data, size_t vertexCount);
+        void UploadIndices(GLuint firstIndex, const GLuint* data, size_t indexCount);
+        void BindInstances(GLuint instanceBuffer);
+        GLuint VertexArray() const;
+        GLuint VertexBuffer() const;
+        GLuint IndexBuffer() const;
+    private:
+        Format format;
+        GLsizei stride;
+        GLuint vertexArray;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        size_t vertexCapacity;
+        size_t indexCapacity;
+        size_t usedVertices;
+        size_t usedIndices;
+        std::vector<ArenaRange> freeVertices;
+        std::vector<ArenaRange> freeIndices;
+        GLuint instanceBuffer;
+        explicit GeometryArena(Format format);
+        GeometryArena(const GeometryArena&) = delete;
+        GeometryArena& operator=(const GeometryArena&) = delete;
+        void Create();
+        void SetupVertexArray();
+        static GLuint GrowBuffer(GLuint buffer, size_t oldBytes, size_t newBytes);
+        static bool TakeRange(std::vector<ArenaRange>& freeList, size_t count, size_t& offset);
+        static void ReleaseRange(std::vector<ArenaRange>& freeList, size_t offset, size_t count);
+    };
+}
+#endif
@@ -0,0 +1,242 @@
+#include "Gjk.hpp"
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include <vector>
+namespace gps {
+    ConvexShape ConvexShape::Sphere(glm::vec3 center, float radius) {
+        ConvexShape shape;
+        shape.hull = NULL;
+        shape.transform = glm::mat4(1.0f);
+        shape.directionTransform = glm::mat3(1.0f);
+        shape.center = center;
+        shape.radius = radius;
+        return shape;
+    }
+    ConvexShape ConvexShape::Hull(const gps::ConvexHull* hull, const glm::mat4& transform) {
+        ConvexShape shape;
+        shape.hull = hull;
+        shape.transform = transform;
+        shape.directionTransform = glm::transpose(glm::mat3(transform));
+        shape.center = glm::vec3(transform * glm::vec4((hull->BoundsMin() + hull->BoundsMax()) * 0.5f, 1.0f));
+        shape.radius = 0.0f;
+        return shape;
+    }
+    glm::vec3 ConvexShape::Support(glm::vec3 direction) const {
+        glm::vec3 point = center;
+        if (hull != NULL) {
+            point = glm::vec3(transform * glm::vec4(hull->Support(directionTransform * direction), 1.0f));
+        }
+        if (radius > 0.0f) {
+            float length = glm::length(direction);
+            if (length > 1e-12f) {
+                point += direction * (radius / length);
+            }
+        }
+        return point;
+    }
+    glm::vec3 Gjk::Support(const gps::ConvexShape& a, const gps::ConvexShape& b, glm::vec3 direction) {
+        return a.Support(direction) - b.Support(-direction);
+    }
+    bool Gjk::Intersect(const gps::ConvexShape& a, const gps::ConvexShape& b) {
+        glm::vec3 simplex[4];
+        int count = 0;
+        return Solve(a, b, simplex, count);
+    }
+    bool Gjk::Solve(const gps::ConvexShape& a, const gps::ConvexShape& b, glm::vec3 simplex[4], int& count) {
+        glm::vec3 direction = a.center - b.center;
+        if (glm::dot(direction, direction) < 1e-12f) {
+            direction = glm::vec3(1.0f, 0.0f, 0.0f);
+        }
+        simplex[0] = Support(a, b, direction);
+        count = 1;
+        direction = -simplex[0];
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+            if (glm::dot(direction, direction) < 1e-12f) {
+                return true;
+            }
+            glm::vec3 point = Support(a, b, direction);
+            if (glm::dot(point, direction) < 0.0f) {
+                return false;
+            }
+            for (int i = count; i > 0; i--) {
+                simplex[i] = simplex[i - 1];
+            }
+            simplex[0] = point;
+            count++;
+            if (NextSimplex(simplex, count, direction)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool Gjk::NextSimplex(glm::vec3 simplex[4], int& count, glm::vec3& direction) {
+        if (count == 2) {
+            return Line(simplex, count, direction);
+        }
+        if (count == 3) {
+            return Triangle(simplex, count, direction);
+        }
+        return Tetrahedron(simplex, count, direction);
+    }
+    bool Gjk::Line(glm::vec3 simplex[4], int& count, glm::vec3& direction) {
+        glm::vec3 a = simplex[0];
+        glm::vec3 ab = simplex[1] - a;
+        glm::vec3 ao = -a;
+        if (glm::dot(ab, ao) > 0.0f) {
+            direction = glm::cross(glm::cross(ab, ao), ab);
+        } else {
+            count = 1;
+            direction = ao;
+        }
+        return false;
+    }
+    bool Gjk::Triangle(glm::vec3 simplex[4], int& count, glm::vec3& direction) {
+        glm::vec3 a = simplex[0];
+        glm::vec3 b = simplex[1];
+        glm::vec3 c = simplex[2];
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ao = -a;
+        glm::vec3 abc = glm::cross(ab, ac);
+        if (glm::dot(glm::cross(abc, ac), ao) > 0.0f) {
+            if (glm::dot(ac, ao) > 0.0f) {
+                simplex[1] = c;
+                count = 2;
+                direction = glm::cross(glm::cross(ac, ao), ac);
+                return false;
+            }
+            count = 2;
+            return Line(simplex, count, direction);
+        }
+        if (glm::dot(glm::cross(ab, abc), ao) > 0.0f) {
+            count = 2;
+            return Line(simplex, count, direction);
+        }
+        if (glm::dot(abc, ao) > 0.0f) {
+            direction = abc;
+        } else {
+            simplex[1] = c;
+            simplex[2] = b;
+            direction = -abc;
+        }
+        return false;
+    }
+    bool Gjk::Tetrahedron(glm::vec3 simplex[4], int& count, glm::vec3& direction) {
+        glm::vec3 a = simplex[0];
+        glm::vec3 b = simplex[1];
+        glm::vec3 c = simplex[2];
+        glm::vec3 d = simplex[3];
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+        glm::vec3 ad = d - a;
+        glm::vec3 ao = -a;
+        if (glm::dot(glm::cross(ab, ac), ao) > 0.0f) {
+            count = 3;
+            return Triangle(simplex, count, direction);
+        }
+        if (glm::dot(glm::cross(ac, ad), ao) > 0.0f) {
+            simplex[1] = c;
+            simplex[2] = d;
+            count = 3;
+            return Triangle(simplex, count, direction);
+        }
+        if (glm::dot(glm::cross(ad, ab), ao) > 0.0f) {
+            simplex[1] = d;
+            simplex[2] = b;
+            count = 3;
+            return Triangle(simplex, count, direction);
+        }
+        return true;
+    }
+    bool Gjk::Penetration(const gps::ConvexShape& a, const gps::ConvexShape& b, gps::Contact& contact) {
+        glm::vec3 simplex[4];
+        int count = 0;
+        if (!Solve(a, b, simplex, count)) {
+            return false;
+        }
+        contact.depth = 0.0f;
+        contact.normal = a.center - b.center;
+        contact.normal = glm::dot(contact.normal, contact.normal) > 1e-12f ? glm::normalize(contact.normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+        if (count < 4) {
+            return true;
+        }
+        std::vector<glm::vec3> vertices(simplex, simplex + 4);
+        std::vector<int> faces = { 0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2 };
+        std::vector<glm::vec4> normals;
+        std::vector<std::pair<int, int> > edges;
+        for (int iteration = 0; iteration < MAX_EPA_ITERATIONS; iteration++) {
+            normals.clear();
+            size_t closest = 0;
+            for (size_t f = 0; f < faces.size(); f += 3) {
+                glm::vec3 p = vertices[faces[f]];
+                glm::vec3 normal = glm::cross(vertices[faces[f + 1]] - p, vertices[faces[f + 2]] - p);
+                float length = glm::length(normal);
+                float distance = FLT_MAX;
+                if (length > 1e-12f) {
+                    normal /= length;
+                    distance = glm::dot(normal, p);
+                    if (distance < 0.0f) {
+                        normal = -normal;
+                        distance = -distance;
+                    }
+                }
+                normals.push_back(glm::vec4(normal, distance));
+                if (distance < normals[closest].w) {
+                    closest = normals.size() - 1;
+                }
+            }
+            glm::vec3 normal = glm::vec3(normals[closest]);
+            float distance = normals[closest].w;
+            if (distance == FLT_MAX) {
+                return true;
+            }
+            glm::vec3 support = Support(a, b, normal);
+            contact.normal = -normal;
+            contact.depth = distance;
+            if (glm::dot(normal, support) - distance < 1e-3f) {
+                return true;
+            }
+            edges.clear();
+            for (size_t n = 0; n < normals.size(); ) {
+                size_t f = n * 3;
+                if (normals[n].w != FLT_MAX && glm::dot(glm::vec3(normals[n]), support - vertices[faces[f]]) <= 0.0f) {
+                    n++;
+                    continue;
+                }
+                for (int e = 0; e < 3; e++) {
+                    std::pair<int, int> edge(faces[f + e], faces[f + (e + 1) % 3]);
+                    bool shared = false;
+                    for (size_t k = 0; k < edges.size(); k++) {
+                        if (edges[k].first == edge.second && edges[k].second == edge.first) {
+                            edges[k] = edges.back();
+                            edges.pop_back();
+                            shared = true;
+                            break;
+                        }
+                    }
+                    if (!shared) {
+                        edges.push_back(edge);
+                    }
+                }
+                faces[f] = faces[faces.size() - 3];
+                faces[f + 1] = faces[faces.size() - 2];
+                faces[f + 2] = faces[faces.size() - 1];
+                faces.resize(faces.size() - 3);
+                normals[n] = normals.back();
+                normals.pop_back();
+            }
+            int newVertex = (int)vertices.size();
+            vertices.push_back(support);
+            for (size_t k = 0; k < edges.size(); k++) {
+                faces.push_back(edges[k].first);
+                faces.push_back(edges[k].second);
+                faces.push_back(newVertex);
+            }
+            if (faces.empty()) {
+                return true;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef Gjk_hpp
+#define Gjk_hpp
+#include <glm/glm.hpp>
+#include "ConvexHull.hpp"
+namespace gps {
+    struct ConvexShape {
+        const gps::ConvexHull* hull;
+        glm::mat4 transform;
+        glm::mat3 directionTransform;
+        glm::vec3 center;
+        float radius;
+        static ConvexShape Sphere(glm::vec3 center, float radius);
+        static ConvexShape Hull(const gps::ConvexHull* hull, const glm::mat4& transform);
+        glm::vec3 Support(glm::vec3 direction) const;
+    };
+    struct Contact {
+        glm::vec3 normal;
+        float depth;
+    };
+    class Gjk {
+    public:
+        static const int MAX_ITERATIONS = 32;
+        static const int MAX_EPA_ITERATIONS = 32;
+        static bool Intersect(const gps::ConvexShape& a, const gps::ConvexShape& b);
+        static bool Penetration(const gps::ConvexShape& a, const gps::ConvexShape& b, gps::Contact& contact);
+    private:
+        static glm::vec3 Support(const gps::ConvexShape& a, const gps::ConvexShape& b, glm::vec3 direction);
+        static bool Solve(const gps::ConvexShape& a, const gps::ConvexShape& b, glm::vec3 simplex[4], int& count);
+        static bool NextSimplex(glm::vec3 simplex[4], int& count, glm::vec3& direction);
+        static bool Line(glm::vec3 simplex[4], int& count, glm::vec3& direction);
+        static bool Triangle(glm::vec3 simplex[4], int& count, glm::vec3& direction);
+        static bool Tetrahedron(glm::vec3 simplex[4], int& count, glm::vec3& direction);
+    };
+}
+#endif
@@ -6,17 +6,18 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Shader.hpp"
+#include "AssetLoader.hpp"
+#include "TextureStreamer.hpp"
 namespace gps {
     class Ground {
     public:
         Ground();
-        void Load(std::string texturePath);
+        void Load(std::string texturePath, gps::AssetLoader& loader);
         void Draw(gps::Shader& shader, glm::mat4 viewMatrix);
     private:
         GLuint groundVAO, groundVBO, groundEBO;
         GLuint textureID;
         void InitGround();
-        GLuint LoadTexture(std::string path);
     };
 }
 #endif  
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "HiZBuffer.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <cstring>
+namespace gps {
+    const int UNIFORM_SOURCE_DEPTH = Shader::internUniform("sourceDepth");
+    const int UNIFORM_COPY_DEPTH = Shader::internUniform("copyDepth");
+    HiZBuffer::HiZBuffer() {
+        framebuffer = 0;
+        depthTexture = 0;
+        pyramidTexture = 0;
+        emptyVertexArray = 0;
+        levelCount = 0;
+        viewProjection = glm::mat4(1.0f);
+        readbackViewProjection = glm::mat4(1.0f);
+        readbackValid = false;
+        readback = false;
+        nextReadback = 0;
+        for (int i = 0; i < READBACK_SLOTS; i++) {
+            readbacks[i].buffer = 0;
+            readbacks[i].fence = 0;
+        }
+    }
+    HiZBuffer::~HiZBuffer() {
+        if (framebuffer == 0) {
+            return;
+        }
+        for (int i = 0; i < READBACK_SLOTS; i++) {
+            if (readbacks[i].fence != 0) {
+                glDeleteSync(readbacks[i].fence);
+            }
+            glDeleteBuffers(1, &readbacks[i].buffer);
+        }
+        glDeleteFramebuffers(1, &framebuffer);
+        GLState::DeleteTextures(1, &depthTexture);
+        GLState::DeleteTextures(1, &pyramidTexture);
+        GLState::DeleteVertexArrays(1, &emptyVertexArray);
+    }
+    void HiZBuffer::Init(bool readback) {
+        this->readback = readback;
+        reduceShader.loadShader("shaders/hiZReduce.vert", "shaders/hiZReduce.frag");
+        levelCount = 1;
+        while ((std::max(WIDTH, HEIGHT) >> levelCount) > 0) {
+            levelCount++;
+        }
+        glGenTextures(1, &depthTexture);
+        GLState::BindTexture(0, GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, WIDTH, HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glGenTextures(1, &pyramidTexture);
+        GLState::BindTexture(0, GL_TEXTURE_2D, pyramidTexture);
+        for (int level = 0; level < levelCount; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(WIDTH >> level, 1), std::max(HEIGHT >> level, 1), 0, GL_RED, GL_FLOAT, NULL);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &framebuffer);
+        glGenVertexArrays(1, &emptyVertexArray);
+        glm::ivec2 size = glm::ivec2(std::max(WIDTH >> READBACK_LEVEL, 1), std::max(HEIGHT >> READBACK_LEVEL, 1));
+        for (int i = 0; i < READBACK_SLOTS; i++) {
+            glGenBuffers(1, &readbacks[i].buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * sizeof(float), NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        while (true) {
+            levelSizes.push_back(size);
+            levels.push_back(std::vector<float>(size.x * size.y, 1.0f));
+            if (size.x == 1 && size.y == 1) {
+                break;
+            }
+            size = glm::ivec2(std::max(size.x / 2, 1), std::max(size.y / 2, 1));
+        }
+    }
+    void HiZBuffer::BeginOccluders() {
+        CollectReadback();
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    void HiZBuffer::EndOccluders(const glm::mat4& viewProjection) {
+        this->viewProjection = viewProjection;
+        BuildPyramid();
+        if (readback) {
+            StartReadback();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    }
+    void HiZBuffer::BuildPyramid() {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        glDrawBuffer(GL_COLOR_ATTACHMENT0);
+        glDisable(GL_DEPTH_TEST);
+        reduceShader.useShaderProgram();
+        reduceShader.setSampler(UNIFORM_SOURCE_DEPTH, 0);
+        GLState::BindVertexArray(emptyVertexArray);
+        for (int level = 0; level < levelCount; level++) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+            glViewport(0, 0, std::max(WIDTH >> level, 1), std::max(HEIGHT >> level, 1));
+            if (level == 0) {
+                GLState::BindTexture(0, GL_TEXTURE_2D, depthTexture);
+                reduceShader.setInt(UNIFORM_COPY_DEPTH, 1);
+            } else {
+                GLState::BindTexture(0, GL_TEXTURE_2D, pyramidTexture);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                reduceShader.setInt(UNIFORM_COPY_DEPTH, 0);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        GLState::BindTexture(0, GL_TEXTURE_2D, pyramidTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glEnable(GL_DEPTH_TEST);
+    }
+    void HiZBuffer::StartReadback() {
+        Readback& slot = readbacks[nextReadback];
+        if (slot.fence != 0) {
+            glDeleteSync(slot.fence);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        GLState::BindTexture(0, GL_TEXTURE_2D, pyramidTexture);
+        glGetTexImage(GL_TEXTURE_2D, READBACK_LEVEL, GL_RED, GL_FLOAT, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.viewProjection = viewProjection;
+        nextReadback = (nextReadback + 1) % READBACK_SLOTS;
+    }
+    void HiZBuffer::CollectReadback() {
+        bool collected = false;
+        for (int i = 0; i < READBACK_SLOTS; i++) {
+            Readback& slot = readbacks[(nextReadback + i) % READBACK_SLOTS];
+            if (slot.fence == 0) {
+                continue;
+            }
+            GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                continue;
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+            size_t bytes = levels[0].size() * sizeof(float);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+            if (data != NULL) {
+                memcpy(levels[0].data(), data, bytes);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                readbackViewProjection = slot.viewProjection;
+                readbackValid = true;
+                collected = true;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        if (!collected) {
+            return;
+        }
+        for (size_t level = 1; level < levels.size(); level++) {
+            glm::ivec2 source = levelSizes[level - 1];
+            glm::ivec2 size = levelSizes[level];
+            const std::vector<float>& previous = levels[level - 1];
+            std::vector<float>& current = levels[level];
+            for (int y = 0; y < size.y; y++) {
+                int y0 = std::min(y * 2, source.y - 1);
+                int y1 = std::min(y * 2 + 1, source.y - 1);
+                for (int x = 0; x < size.x; x++) {
+                    int x0 = std::min(x * 2, source.x - 1);
+                    int x1 = std::min(x * 2 + 1, source.x - 1);
+                    current[y * size.x + x] = std::max(std::max(previous[y0 * source.x + x0], previous[y0 * source.x + x1]),
+                                                       std::max(previous[y1 * source.x + x0], previous[y1 * source.x + x1]));
+                }
+            }
+        }
+    }
+    bool HiZBuffer::IsOccluded(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4& modelMatrix) const {
+        if (!readbackValid) {
+            return false;
+        }
+        glm::mat4 transform = readbackViewProjection * modelMatrix;
+        float minX = 1.0f;
+        float minY = 1.0f;
+        float maxX = -1.0f;
+        float maxY = -1.0f;
+        float nearest = 1.0f;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 point = glm::vec3((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+            glm::vec4 clip = transform * glm::vec4(point, 1.0f);
+            if (clip.w <= 0.0f) {
+                return false;
+            }
+            minX = std::min(minX, clip.x / clip.w);
+            minY = std::min(minY, clip.y / clip.w);
+            maxX = std::max(maxX, clip.x / clip.w);
+            maxY = std::max(maxY, clip.y / clip.w);
+            nearest = std::min(nearest, clip.z / clip.w * 0.5f + 0.5f);
+        }
+        if (nearest <= 0.0f || maxX < -1.0f || maxY < -1.0f || minX > 1.0f || minY > 1.0f) {
+            return false;
+        }
+        glm::ivec2 extent = levelSizes[0];
+        int x0 = (int)((std::max(minX, -1.0f) * 0.5f + 0.5f) * extent.x);
+        int y0 = (int)((std::max(minY, -1.0f) * 0.5f + 0.5f) * extent.y);
+        int x1 = (int)((std::min(maxX, 1.0f) * 0.5f + 0.5f) * extent.x);
+        int y1 = (int)((std::min(maxY, 1.0f) * 0.5f + 0.5f) * extent.y);
+        size_t level = 0;
+        while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+            level++;
+        }
+        glm::ivec2 size = levelSizes[level];
+        float farthest = 0.0f;
+        for (int y = std::min(y0 >> level, size.y - 1); y <= std::min(y1 >> level, size.y - 1); y++) {
+            for (int x = std::min(x0 >> level, size.x - 1); x <= std::min(x1 >> level, size.x - 1); x++) {
+                farthest = std::max(farthest, levels[level][y * size.x + x]);
+            }
+        }
+        return nearest > farthest;
+    }
+    GLuint HiZBuffer::PyramidTexture() const {
+        return pyramidTexture;
+    }
+    int HiZBuffer::LevelCount() const {
+        return levelCount;
+    }
+    const glm::mat4& HiZBuffer::ViewProjection() const {
+        return viewProjection;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef HiZBuffer_hpp
+#define HiZBuffer_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include <glm/glm.hpp>
+#include <vector>
+#include "Shader.hpp"
+namespace gps {
+    struct OcclusionStats {
+        int visible;
+        int occluded;
+    };
+    class HiZBuffer {
+    public:
+        static const int WIDTH = 512;
+        static const int HEIGHT = 256;
+        static const int READBACK_LEVEL = 2;
+        static const int READBACK_SLOTS = 2;
+        HiZBuffer();
+        ~HiZBuffer();
+        void Init(bool readback);
+        void BeginOccluders();
+        void EndOccluders(const glm::mat4& viewProjection);
+        bool IsOccluded(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4& modelMatrix) const;
+        GLuint PyramidTexture() const;
+        int LevelCount() const;
+        const glm::mat4& ViewProjection() const;
+    private:
+        struct Readback {
+            GLuint buffer;
+            GLsync fence;
+            glm::mat4 viewProjection;
+        };
+        gps::Shader reduceShader;
+        GLuint framebuffer;
+        GLuint depthTexture;
+        GLuint pyramidTexture;
+        GLuint emptyVertexArray;
+        int levelCount;
+        glm::mat4 viewProjection;
+        GLint savedViewport[4];
+        Readback readbacks[READBACK_SLOTS];
+        int nextReadback;
+        std::vector<std::vector<float> > levels;
+        std::vector<glm::ivec2> levelSizes;
+        glm::mat4 readbackViewProjection;
+        bool readbackValid;
+        bool readback;
+        HiZBuffer(const HiZBuffer&) = delete;
+        HiZBuffer& operator=(const HiZBuffer&) = delete;
+        void BuildPyramid();
+        void CollectReadback();
+        void StartReadback();
+    };
+}
+#endif
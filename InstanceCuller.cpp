@@ -0,0 +1,339 @@
+#include "InstanceCuller.hpp"
+#include "GeometryArena.hpp"
+#include "RenderQueue.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <cstring>
+namespace gps {
+    const int UNIFORM_FRUSTUM_PLANES[Frustum::PLANE_COUNT] = {
+        Shader::internUniform("frustumPlanes[0]"),
+        Shader::internUniform("frustumPlanes[1]"),
+        Shader::internUniform("frustumPlanes[2]"),
+        Shader::internUniform("frustumPlanes[3]"),
+        Shader::internUniform("frustumPlanes[4]"),
+        Shader::internUniform("frustumPlanes[5]")
+    };
+    const int UNIFORM_CULL_ORIGIN = Shader::internUniform("cullOrigin");
+    const int UNIFORM_FOG_CUTOFF = Shader::internUniform("fogCutoff");
+    const int UNIFORM_LOD_SCALE = Shader::internUniform("lodScale");
+    const int UNIFORM_LOD_PIXEL_ERROR = Shader::internUniform("lodPixelError");
+    const int UNIFORM_LOD_HYSTERESIS = Shader::internUniform("lodHysteresis");
+    const int UNIFORM_UPDATE_LOD = Shader::internUniform("updateLod");
+    const int UNIFORM_INSTANCE_COUNT = Shader::internUniform("instanceCount");
+    const int UNIFORM_COMMAND_COUNT = Shader::internUniform("commandCount");
+    const int UNIFORM_HIZ = Shader::internUniform("hiZ");
+    const int UNIFORM_HIZ_VIEW_PROJECTION = Shader::internUniform("hiZViewProjection");
+    const int UNIFORM_HIZ_LEVELS = Shader::internUniform("hiZLevels");
+    const int UNIFORM_OCCLUSION_TEST = Shader::internUniform("occlusionTest");
+    bool InstanceCuller::Supported() {
+        return RenderQueue::MultiDrawIndirect();
+    }
+    InstanceCuller::InstanceCuller() {
+        instanceBuffer = 0;
+        lodStateBuffer = 0;
+        modelBuffer = 0;
+        commandGroupBuffer = 0;
+        instanceCapacity = 0;
+        visibleCount = 0;
+        for (int p = 0; p < PASS_COUNT; p++) {
+            passes[p].groups = 0;
+            passes[p].visible = 0;
+            passes[p].commands = 0;
+        }
+        for (int i = 0; i < OCCLUSION_SLOTS; i++) {
+            occlusionBuffers[i] = 0;
+            occlusionFences[i] = 0;
+        }
+        occlusionSlot = 0;
+        occlusionStats.visible = 0;
+        occlusionStats.occluded = 0;
+        layoutDirty = true;
+    }
+    InstanceCuller::~InstanceCuller() {
+        if (instanceBuffer == 0) {
+            return;
+        }
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteBuffers(1, &lodStateBuffer);
+        glDeleteBuffers(1, &modelBuffer);
+        glDeleteBuffers(1, &commandGroupBuffer);
+        for (int i = 0; i < OCCLUSION_SLOTS; i++) {
+            if (occlusionFences[i] != 0) {
+                glDeleteSync(occlusionFences[i]);
+            }
+        }
+        glDeleteBuffers(OCCLUSION_SLOTS, occlusionBuffers);
+        for (int p = 0; p < PASS_COUNT; p++) {
+            GeometryArena::ForgetInstanceBuffer(passes[p].visible);
+            glDeleteBuffers(1, &passes[p].groups);
+            glDeleteBuffers(1, &passes[p].visible);
+            glDeleteBuffers(1, &passes[p].commands);
+        }
+    }
+    void InstanceCuller::Init() {
+        cullShader.loadComputeShader("shaders/instanceCull.comp");
+        commandShader.loadComputeShader("shaders/instanceCommands.comp");
+        glGenBuffers(1, &instanceBuffer);
+        glGenBuffers(1, &lodStateBuffer);
+        glGenBuffers(1, &modelBuffer);
+        glGenBuffers(1, &commandGroupBuffer);
+        for (int p = 0; p < PASS_COUNT; p++) {
+            glGenBuffers(1, &passes[p].groups);
+            glGenBuffers(1, &passes[p].visible);
+            glGenBuffers(1, &passes[p].commands);
+        }
+#if not defined (__APPLE__)
+        GLuint zeros[2] = { 0, 0 };
+        glGenBuffers(OCCLUSION_SLOTS, occlusionBuffers);
+        for (int i = 0; i < OCCLUSION_SLOTS; i++) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, occlusionBuffers[i]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#endif
+    }
+    GLuint InstanceCuller::AddModel(gps::Model3D* model) {
+        models.push_back(model);
+        registeredLods.push_back(0);
+        modelInstanceCounts.push_back(0);
+        layoutDirty = true;
+        return (GLuint)(models.size() - 1);
+    }
+    bool InstanceCuller::Refresh() {
+        bool changed = false;
+        for (size_t m = 0; m < models.size(); m++) {
+            int lodCount = models[m]->LodMeshes(0).empty() ? 0 : std::min(models[m]->LodCount(), CULL_MAX_LODS);
+            if (lodCount != registeredLods[m]) {
+                registeredLods[m] = lodCount;
+                layoutDirty = true;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+    void InstanceCuller::SetInstances(const std::vector<gps::CullInstance>& instances) {
+        std::vector<size_t> counts(models.size(), 0);
+        for (size_t i = 0; i < instances.size(); i++) {
+            counts[instances[i].modelIndex]++;
+        }
+        if (counts != modelInstanceCounts) {
+            modelInstanceCounts.swap(counts);
+            layoutDirty = true;
+        }
+        UploadInstances(instances);
+    }
+    void InstanceCuller::UploadInstances(const std::vector<gps::CullInstance>& instances) {
+#if not defined (__APPLE__)
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+        if (instances.size() > instanceCapacity) {
+            instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCapacity * sizeof(gps::CullInstance), NULL, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instances.size() * sizeof(gps::CullInstance), instances.data());
+            std::vector<GLuint> lodStates(instanceCapacity, 0);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, lodStateBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, lodStates.size() * sizeof(GLuint), lodStates.data(), GL_DYNAMIC_COPY);
+        } else {
+            size_t i = 0;
+            while (i < instances.size()) {
+                if (i < uploaded.size() && memcmp(&instances[i], &uploaded[i], sizeof(gps::CullInstance)) == 0) {
+                    i++;
+                    continue;
+                }
+                size_t end = i + 1;
+                while (end < instances.size() && (end >= uploaded.size() || memcmp(&instances[end], &uploaded[end], sizeof(gps::CullInstance)) != 0)) {
+                    end++;
+                }
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, i * sizeof(gps::CullInstance), (end - i) * sizeof(gps::CullInstance), &instances[i]);
+                i = end;
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        uploaded = instances;
+#endif
+    }
+    void InstanceCuller::RebuildLayout() {
+#if not defined (__APPLE__)
+        groups.clear();
+        commands.clear();
+        commandGroups.clear();
+        buckets.clear();
+        std::vector<gps::CullModel> modelData(models.size());
+        std::vector<gps::Mesh*> meshes;
+        std::vector<gps::DrawElementsIndirectCommand> pendingCommands;
+        std::vector<GLuint> pendingGroups;
+        GLuint base = 0;
+        for (size_t m = 0; m < models.size(); m++) {
+            gps::CullModel& data = modelData[m];
+            data.lodCount = (GLuint)registeredLods[m];
+            data.firstGroup = (GLuint)groups.size();
+            data.boundsMin = glm::vec4(models[m]->boundsMin, 1.0f);
+            data.boundsMax = glm::vec4(models[m]->boundsMax, 1.0f);
+            for (int lod = 0; lod < registeredLods[m]; lod++) {
+                data.lodErrors[lod] = models[m]->LodError(lod);
+                gps::CullGroup group = { base, 0 };
+                GLuint groupIndex = (GLuint)groups.size();
+                groups.push_back(group);
+                base += (GLuint)modelInstanceCounts[m];
+                std::vector<gps::Mesh>& lodMeshes = models[m]->LodMeshes(lod);
+                for (size_t i = 0; i < lodMeshes.size(); i++) {
+                    meshes.push_back(&lodMeshes[i]);
+                    pendingCommands.push_back(lodMeshes[i].IndirectCommand(0, group.base));
+                    pendingGroups.push_back(groupIndex);
+                }
+            }
+        }
+        visibleCount = base;
+        std::vector<size_t> meshBuckets(meshes.size());
+        for (size_t i = 0; i < meshes.size(); i++) {
+            size_t bucket = buckets.size();
+            for (size_t b = 0; b < buckets.size(); b++) {
+                if (buckets[b].mesh->SharesMaterial(*meshes[i])) {
+                    bucket = b;
+                    break;
+                }
+            }
+            if (bucket == buckets.size()) {
+                CullBucket created = { meshes[i], 0, 0 };
+                buckets.push_back(created);
+            }
+            buckets[bucket].count++;
+            meshBuckets[i] = bucket;
+        }
+        size_t first = 0;
+        for (size_t b = 0; b < buckets.size(); b++) {
+            buckets[b].first = first;
+            first += buckets[b].count;
+            buckets[b].count = 0;
+        }
+        commands.resize(meshes.size());
+        commandGroups.resize(meshes.size());
+        for (size_t i = 0; i < meshes.size(); i++) {
+            CullBucket& bucket = buckets[meshBuckets[i]];
+            size_t slot = bucket.first + bucket.count++;
+            commands[slot] = pendingCommands[i];
+            commandGroups[slot] = pendingGroups[i];
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, modelBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(modelData.size(), 1) * sizeof(gps::CullModel), modelData.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandGroupBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(commandGroups.size(), 1) * sizeof(GLuint), commandGroups.data(), GL_STATIC_DRAW);
+        for (int p = 0; p < PASS_COUNT; p++) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, passes[p].groups);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(groups.size(), 1) * sizeof(gps::CullGroup), NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, passes[p].visible);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(visibleCount, 1) * sizeof(gps::InstanceData), NULL, GL_DYNAMIC_COPY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, passes[p].commands);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(commands.size(), 1) * sizeof(gps::DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        layoutDirty = false;
+#endif
+    }
+    void InstanceCuller::Cull(Pass pass, const gps::Frustum& frustum, glm::vec3 origin, float fogCutoff, float lodScale, float lodPixelError, float lodHysteresis, bool updateLod,
+                              const gps::HiZBuffer* hiZ) {
+#if not defined (__APPLE__)
+        if (layoutDirty) {
+            RebuildLayout();
+        }
+        if (commands.empty()) {
+            return;
+        }
+        PassBuffers& buffers = passes[pass];
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers.groups);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, groups.size() * sizeof(gps::CullGroup), groups.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, lodStateBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, modelBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, buffers.groups);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, buffers.visible);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, buffers.commands);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, commandGroupBuffer);
+        if (hiZ != NULL) {
+            CollectOcclusion();
+            occlusionSlot = (occlusionSlot + 1) % OCCLUSION_SLOTS;
+            if (occlusionFences[occlusionSlot] != 0) {
+                glDeleteSync(occlusionFences[occlusionSlot]);
+                occlusionFences[occlusionSlot] = 0;
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, occlusionBuffers[occlusionSlot]);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, occlusionBuffers[occlusionSlot]);
+        if (!uploaded.empty()) {
+            cullShader.useShaderProgram();
+            for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+                cullShader.setVec4(UNIFORM_FRUSTUM_PLANES[i], frustum.GetPlane(i));
+            }
+            cullShader.setVec3(UNIFORM_CULL_ORIGIN, origin);
+            cullShader.setFloat(UNIFORM_FOG_CUTOFF, fogCutoff);
+            cullShader.setFloat(UNIFORM_LOD_SCALE, lodScale);
+            cullShader.setFloat(UNIFORM_LOD_PIXEL_ERROR, lodPixelError);
+            cullShader.setFloat(UNIFORM_LOD_HYSTERESIS, lodHysteresis);
+            cullShader.setInt(UNIFORM_UPDATE_LOD, updateLod ? 1 : 0);
+            cullShader.setInt(UNIFORM_INSTANCE_COUNT, (GLint)uploaded.size());
+            cullShader.setInt(UNIFORM_OCCLUSION_TEST, hiZ != NULL ? 1 : 0);
+            if (hiZ != NULL) {
+                GLState::BindTexture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, hiZ->PyramidTexture());
+                cullShader.setSampler(UNIFORM_HIZ, HIZ_TEXTURE_UNIT);
+                cullShader.setMat4(UNIFORM_HIZ_VIEW_PROJECTION, hiZ->ViewProjection());
+                cullShader.setInt(UNIFORM_HIZ_LEVELS, hiZ->LevelCount());
+            }
+            glDispatchCompute((GLuint)((uploaded.size() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            if (hiZ != NULL) {
+                occlusionFences[occlusionSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+        }
+        commandShader.useShaderProgram();
+        commandShader.setInt(UNIFORM_COMMAND_COUNT, (GLint)commands.size());
+        glDispatchCompute((GLuint)((commands.size() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE), 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+#endif
+    }
+    void InstanceCuller::CollectOcclusion() {
+#if not defined (__APPLE__)
+        for (int i = 1; i <= OCCLUSION_SLOTS; i++) {
+            int slot = (occlusionSlot + i) % OCCLUSION_SLOTS;
+            if (occlusionFences[slot] == 0) {
+                continue;
+            }
+            GLenum status = glClientWaitSync(occlusionFences[slot], 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                continue;
+            }
+            glDeleteSync(occlusionFences[slot]);
+            occlusionFences[slot] = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, occlusionBuffers[slot]);
+            const GLuint* counters = (const GLuint*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, 2 * sizeof(GLuint), GL_MAP_READ_BIT);
+            if (counters != NULL) {
+                occlusionStats.visible = (int)counters[0];
+                occlusionStats.occluded = (int)counters[1];
+                glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+#endif
+    }
+    gps::OcclusionStats InstanceCuller::GetOcclusionStats() const {
+        return occlusionStats;
+    }
+    void InstanceCuller::Draw(Pass pass, gps::Shader& shader) {
+#if not defined (__APPLE__)
+        if (commands.empty() || layoutDirty) {
+            return;
+        }
+        PassBuffers& buffers = passes[pass];
+        shader.useShaderProgram();
+        shader.setInt(gps::Shader::UNIFORM_IS_INSTANCED, 1);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers.commands);
+        for (size_t b = 0; b < buckets.size(); b++) {
+            buckets[b].mesh->BindIndirect(shader, buffers.visible);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)(buckets[b].first * sizeof(gps::DrawElementsIndirectCommand)), (GLsizei)buckets[b].count, 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        shader.setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+#endif
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef InstanceCuller_hpp
+#define InstanceCuller_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include <glm/glm.hpp>
+#include <vector>
+#include "Model3D.hpp"
+#include "Shader.hpp"
+#include "Frustum.hpp"
+#include "HiZBuffer.hpp"
+namespace gps {
+    const int CULL_MAX_LODS = 8;
+    struct CullInstance {
+        glm::mat4 model;
+        glm::vec4 color;
+        glm::vec4 sphere;
+        GLuint modelIndex;
+        GLuint padding[3];
+    };
+    struct CullModel {
+        float lodErrors[CULL_MAX_LODS];
+        GLuint lodCount;
+        GLuint firstGroup;
+        GLuint padding[2];
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+    };
+    struct CullGroup {
+        GLuint base;
+        GLuint count;
+    };
+    class InstanceCuller {
+    public:
+        enum Pass {
+            PASS_SHADOW,
+            PASS_MAIN,
+            PASS_COUNT
+        };
+        static const GLuint WORKGROUP_SIZE = 64;
+        static const GLuint HIZ_TEXTURE_UNIT = 4;
+        static const int OCCLUSION_SLOTS = 3;
+        static bool Supported();
+        InstanceCuller();
+        ~InstanceCuller();
+        void Init();
+        GLuint AddModel(gps::Model3D* model);
+        bool Refresh();
+        void SetInstances(const std::vector<gps::CullInstance>& instances);
+        void Cull(Pass pass, const gps::Frustum& frustum, glm::vec3 origin, float fogCutoff, float lodScale, float lodPixelError, float lodHysteresis, bool updateLod,
+                  const gps::HiZBuffer* hiZ = NULL);
+        void Draw(Pass pass, gps::Shader& shader);
+        gps::OcclusionStats GetOcclusionStats() const;
+    private:
+        struct CullBucket {
+            gps::Mesh* mesh;
+            size_t first;
+            size_t count;
+        };
+        struct PassBuffers {
+            GLuint groups;
+            GLuint visible;
+            GLuint commands;
+        };
+        gps::Shader cullShader;
+        gps::Shader commandShader;
+        std::vector<gps::Model3D*> models;
+        std::vector<int> registeredLods;
+        std::vector<size_t> modelInstanceCounts;
+        std::vector<gps::CullInstance> uploaded;
+        std::vector<gps::CullGroup> groups;
+        std::vector<gps::DrawElementsIndirectCommand> commands;
+        std::vector<GLuint> commandGroups;
+        std::vector<CullBucket> buckets;
+        GLuint instanceBuffer;
+        GLuint lodStateBuffer;
+        GLuint modelBuffer;
+        GLuint commandGroupBuffer;
+        size_t instanceCapacity;
+        size_t visibleCount;
+        PassBuffers passes[PASS_COUNT];
+        GLuint occlusionBuffers[OCCLUSION_SLOTS];
+        GLsync occlusionFences[OCCLUSION_SLOTS];
+        int occlusionSlot;
+        gps::OcclusionStats occlusionStats;
+        bool layoutDirty;
+        InstanceCuller(const InstanceCuller&) = delete;
+        InstanceCuller& operator=(const InstanceCuller&) = delete;
+        void RebuildLayout();
+        void UploadInstances(const std::vector<gps::CullInstance>& instances);
+        void CollectOcclusion();
+    };
+}
+#endif
@@ -0,0 +1,100 @@
+#include "MappedFile.hpp"
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+namespace gps {
+    MappedFile::MappedFile() {
+        data = NULL;
+        size = 0;
+#if defined(_WIN32)
+        fileHandle = INVALID_HANDLE_VALUE;
+        mappingHandle = NULL;
+#else
+        fileDescriptor = -1;
+#endif
+    }
+    MappedFile::~MappedFile() {
+        Close();
+    }
+    bool MappedFile::Open(const std::string& path) {
+        Close();
+#if defined(_WIN32)
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            Close();
+            return false;
+        }
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle == NULL) {
+            Close();
+            return false;
+        }
+        data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL) {
+            Close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+#else
+        fileDescriptor = open(path.c_str(), O_RDONLY);
+        if (fileDescriptor < 0) {
+            return false;
+        }
+        struct stat fileInfo;
+        if (fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0) {
+            Close();
+            return false;
+        }
+        void* mapping = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping == MAP_FAILED) {
+            Close();
+            return false;
+        }
+        data = (const unsigned char*)mapping;
+        size = (size_t)fileInfo.st_size;
+#endif
+        return true;
+    }
+    void MappedFile::Close() {
+#if defined(_WIN32)
+        if (data != NULL) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle != NULL) {
+            CloseHandle(mappingHandle);
+            mappingHandle = NULL;
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data != NULL) {
+            munmap((void*)data, size);
+        }
+        if (fileDescriptor >= 0) {
+            close(fileDescriptor);
+            fileDescriptor = -1;
+        }
+#endif
+        data = NULL;
+        size = 0;
+    }
+    const unsigned char* MappedFile::Data() const {
+        return data;
+    }
+    size_t MappedFile::Size() const {
+        return size;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+#include <string>
+#include <cstddef>
+namespace gps {
+    class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        bool Open(const std::string& path);
+        void Close();
+        const unsigned char* Data() const;
+        size_t Size() const;
+    private:
+        const unsigned char* data;
+        size_t size;
+#if defined(_WIN32)
+        void* fileHandle;
+        void* mappingHandle;
+#else
+        int fileDescriptor;
+#endif
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+    };
+}
+#endif
@@ -1,53 +1,128 @@
 #include "Mesh.hpp"
+#include "TextureStreamer.hpp"
+#include "GeometryArena.hpp"
+#include "GLState.hpp"
+#include <algorithm>
 namespace gps {
-	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures, glm::vec3 Ka, glm::vec3 Kd, glm::vec3 Ks) {
-		this->vertices = vertices;
-		this->indices = indices;
+	TextureResource::TextureResource() {
+		id = 0;
+		bytes = 0;
+		duplicates = 0;
+	}
+	TextureResource::~TextureResource() {
+		if (id != 0) {
+			GLState::DeleteTextures(1, &id);
+		}
+	}
+	GLuint TextureResource::Name() {
+		if (id == 0) {
+			glGenTextures(1, &id);
+			TextureStreamer::Placeholder(id);
+		}
+		return id;
+	}
+	GLuint MeshGeometry::nextId = 1;
+	MeshGeometry::MeshGeometry(const MeshData& mesh) {
+		id = nextId++;
+		compact = mesh.compactData != NULL;
+		positionOffset = compact ? mesh.positionOffset : glm::vec3(0.0f);
+		positionScale = compact ? mesh.positionScale : glm::vec3(1.0f);
+		arena = &GeometryArena::Get(compact ? GeometryArena::FORMAT_COMPACT : GeometryArena::FORMAT_FLOAT);
+		vertexCount = mesh.vertexCount;
+		indexCount = mesh.indexCount;
+		for (size_t i = 0; i < mesh.lods.size(); i++) {
+			indexCount += mesh.lods[i].indexCount;
+		}
+		arena->Allocate(vertexCount, indexCount, baseVertex, firstIndex);
+		arena->UploadVertices(baseVertex, compact ? (const void*)mesh.compactData : (const void*)mesh.vertexData, vertexCount);
+		arena->UploadIndices(firstIndex, mesh.indexData, mesh.indexCount);
+		MeshLod full = { (GLsizei)firstIndex, (GLsizei)mesh.indexCount, 0.0f };
+		lods.push_back(full);
+		GLuint offset = firstIndex + (GLuint)mesh.indexCount;
+		for (size_t i = 0; i < mesh.lods.size(); i++) {
+			arena->UploadIndices(offset, mesh.lods[i].indexData, mesh.lods[i].indexCount);
+			MeshLod lod = { (GLsizei)offset, (GLsizei)mesh.lods[i].indexCount, mesh.lods[i].error };
+			lods.push_back(lod);
+			offset += (GLuint)mesh.lods[i].indexCount;
+		}
+		bytes = vertexCount * (compact ? sizeof(CompactVertex) : sizeof(Vertex)) + indexCount * sizeof(GLuint);
+	}
+	MeshGeometry::~MeshGeometry() {
+		arena->Free(baseVertex, vertexCount, firstIndex, indexCount);
+	}
+	Mesh::Mesh(std::shared_ptr<MeshGeometry> geometry, std::vector<Texture> textures, glm::vec3 Ka, glm::vec3 Kd, glm::vec3 Ks, size_t lod) {
+		this->geometry = geometry;
 		this->textures = textures;
         this->Ka = Ka;
         this->Kd = Kd;
         this->Ks = Ks;
-		this->setupMesh();
+		this->setupMesh(lod);
 	}
 	Buffers Mesh::getBuffers() {
-	    return this->buffers;
+		Buffers buffers = { geometry->arena->VertexArray(), geometry->arena->VertexBuffer(), geometry->arena->IndexBuffer() };
+	    return buffers;
 	}
-	void Mesh::Draw(gps::Shader shader)	{
+	void Mesh::Draw(gps::Shader& shader)	{
 		shader.useShaderProgram();
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "Ka"), 1, &Ka[0]);
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "Kd"), 1, &Kd[0]);
-        glUniform3fv(glGetUniformLocation(shader.shaderProgram, "Ks"), 1, &Ks[0]);
-        int hasTexture = 0;
-        if (textures.size() > 0) hasTexture = 1;
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "hasTexture"), hasTexture);
-		for (GLuint i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
-		}
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-        for(GLuint i = 0; i < this->textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
+		bindMaterial(shader);
+		geometry->arena->BindInstances(0);
+		glDrawElementsBaseVertex(GL_TRIANGLES, this->indexCount, GL_UNSIGNED_INT, (GLvoid*)(this->indexOffset * sizeof(GLuint)), geometry->baseVertex);
     }
-	void Mesh::setupMesh() {
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
-		glBindVertexArray(this->buffers.VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
-		glBindVertexArray(0);
+	void Mesh::DrawInstanced(gps::Shader& shader, GLsizei instanceCount) {
+		bindMaterial(shader);
+		geometry->arena->BindInstances(this->instanceBuffer);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, this->indexCount, GL_UNSIGNED_INT, (GLvoid*)(this->indexOffset * sizeof(GLuint)), instanceCount, geometry->baseVertex);
+	}
+	void Mesh::bindMaterial(gps::Shader& shader) {
+        shader.setVec3(gps::Shader::UNIFORM_KA, Ka);
+        shader.setVec3(gps::Shader::UNIFORM_KD, Kd);
+        shader.setVec3(gps::Shader::UNIFORM_KS, Ks);
+        shader.setInt(gps::Shader::UNIFORM_HAS_TEXTURE, textures.size() > 0 ? 1 : 0);
+        shader.setVec3(gps::Shader::UNIFORM_POSITION_OFFSET, geometry->positionOffset);
+        shader.setVec3(gps::Shader::UNIFORM_POSITION_SCALE, geometry->positionScale);
+		for (GLuint i = 0; i < textures.size(); i++) {
+			shader.setSampler(this->textures[i].samplerUniform, i);
+			GLState::BindTexture(i, GL_TEXTURE_2D, this->textures[i].id);
+		}
+		for (GLuint i = (GLuint)textures.size(); i < MATERIAL_TEXTURE_UNITS; i++) {
+			GLState::BindTexture(i, GL_TEXTURE_2D, 0);
+		}
+	}
+	void Mesh::SetupInstanceAttributes(GLuint instanceVBO) {
+		this->instanceBuffer = instanceVBO;
+	}
+	bool Mesh::SharesMaterial(const Mesh& other) const {
+		if (geometry->arena != other.geometry->arena || geometry->positionOffset != other.geometry->positionOffset ||
+			geometry->positionScale != other.geometry->positionScale) {
+			return false;
+		}
+		if (Ka != other.Ka || Kd != other.Kd || Ks != other.Ks || textures.size() != other.textures.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < textures.size(); i++) {
+			if (textures[i].id != other.textures[i].id || textures[i].samplerUniform != other.textures[i].samplerUniform) {
+				return false;
+			}
+		}
+		return true;
+	}
+	void Mesh::BindIndirect(gps::Shader& shader, GLuint instanceVBO) {
+		bindMaterial(shader);
+		geometry->arena->BindInstances(instanceVBO);
+	}
+	DrawElementsIndirectCommand Mesh::IndirectCommand(GLuint instanceCount, GLuint baseInstance) const {
+		DrawElementsIndirectCommand command;
+		command.count = (GLuint)this->indexCount;
+		command.instanceCount = instanceCount;
+		command.firstIndex = (GLuint)this->indexOffset;
+		command.baseVertex = geometry->baseVertex;
+		command.baseInstance = baseInstance;
+		return command;
+	}
+	void Mesh::setupMesh(size_t lod) {
+		lod = std::min(lod, geometry->lods.size() - 1);
+		this->indexOffset = geometry->lods[lod].indexOffset;
+		this->indexCount = geometry->lods[lod].indexCount;
+		this->instanceBuffer = 0;
 	}
 }
\ No newline at end of file
@@ -11,22 +11,96 @@
 #include "Shader.hpp"
 #include <string>
 #include <vector>
+#include <memory>
 namespace gps {
+    class GeometryArena;
     struct Vertex {
         glm::vec3 Position;
         glm::vec3 Normal;
         glm::vec2 TexCoords;
     };
+    struct CompactVertex {
+        unsigned short Position[4];
+        GLuint Normal;
+        unsigned short TexCoords[2];
+    };
+    struct TextureResource {
+        GLuint id;
+        size_t bytes;
+        int duplicates;
+        TextureResource();
+        ~TextureResource();
+        GLuint Name();
+        TextureResource(const TextureResource&) = delete;
+        TextureResource& operator=(const TextureResource&) = delete;
+    };
     struct Texture {
         GLuint id;
         std::string type;
         std::string path;
+        int samplerUniform;
+        std::shared_ptr<TextureResource> resource;
     };
     struct Material {
         glm::vec3 ambient;
         glm::vec3 diffuse;
         glm::vec3 specular;
     };
+    struct MeshLodData {
+        const GLuint* indexData;
+        size_t indexCount;
+        float error;
+    };
+    struct MeshLod {
+        GLsizei indexOffset;
+        GLsizei indexCount;
+        float error;
+    };
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        const Vertex* vertexData;
+        size_t vertexCount;
+        const GLuint* indexData;
+        size_t indexCount;
+        std::vector<std::vector<GLuint> > lodIndices;
+        std::vector<MeshLodData> lods;
+        std::vector<CompactVertex> compactVertices;
+        const CompactVertex* compactData;
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        Material material;
+        std::vector<Texture> textures;
+    };
+    struct InstanceData {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    struct MeshGeometry {
+        static GLuint nextId;
+        GLuint id;
+        GeometryArena* arena;
+        GLint baseVertex;
+        size_t vertexCount;
+        GLuint firstIndex;
+        size_t indexCount;
+        std::vector<MeshLod> lods;
+        size_t bytes;
+        bool compact;
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        explicit MeshGeometry(const MeshData& mesh);
+        ~MeshGeometry();
+        MeshGeometry(const MeshGeometry&) = delete;
+        MeshGeometry& operator=(const MeshGeometry&) = delete;
+    };
     struct Buffers {
         GLuint VAO;
         GLuint VBO;
@@ -34,19 +108,27 @@ namespace gps {
     };
     class Mesh {
     public:
-        std::vector<Vertex> vertices;
-        std::vector<GLuint> indices;
+        static const GLuint MATERIAL_TEXTURE_UNITS = 3;
         std::vector<Texture> textures;
+        std::shared_ptr<MeshGeometry> geometry;
         glm::vec3 Ka;
         glm::vec3 Kd;
         glm::vec3 Ks;
-	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures,
-             glm::vec3 Ka = glm::vec3(1.0f), glm::vec3 Kd = glm::vec3(1.0f), glm::vec3 Ks = glm::vec3(1.0f));
+        GLsizei indexOffset;
+        GLsizei indexCount;
+        GLuint instanceBuffer;
+	    Mesh(std::shared_ptr<MeshGeometry> geometry, std::vector<Texture> textures,
+             glm::vec3 Ka = glm::vec3(1.0f), glm::vec3 Kd = glm::vec3(1.0f), glm::vec3 Ks = glm::vec3(1.0f), size_t lod = 0);
 	    Buffers getBuffers();
-	    void Draw(gps::Shader shader);
+	    void Draw(gps::Shader& shader);
+	    void DrawInstanced(gps::Shader& shader, GLsizei instanceCount);
+	    void SetupInstanceAttributes(GLuint instanceVBO);
+	    bool SharesMaterial(const Mesh& other) const;
+	    void BindIndirect(gps::Shader& shader, GLuint instanceVBO);
+	    DrawElementsIndirectCommand IndirectCommand(GLuint instanceCount, GLuint baseInstance) const;
     private:
-        Buffers buffers;
-	    void setupMesh();
+	    void setupMesh(size_t lod);
+	    void bindMaterial(gps::Shader& shader);
     };
 }
 #endif  
\ No newline at end of file
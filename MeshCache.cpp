@@ -0,0 +1,218 @@
+#include "MeshCache.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#if defined(_WIN32)
+    #include <direct.h>
+#endif
+namespace gps {
+    static const char* CACHE_DIRECTORY = "cache";
+    static unsigned long long AlignOffset(unsigned long long offset) {
+        return (offset + 15) & ~15ull;
+    }
+    std::string MeshCache::CachePath(const std::string& sourceFile, const std::string& extension) {
+        std::string name = sourceFile;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (name[i] == '/' || name[i] == '\\' || name[i] == ':' || name[i] == ' ') {
+                name[i] = '_';
+            }
+        }
+        return std::string(CACHE_DIRECTORY) + "/" + name + extension;
+    }
+    void MeshCache::EnsureCacheDirectory() {
+#if defined(_WIN32)
+        _mkdir(CACHE_DIRECTORY);
+#else
+        mkdir(CACHE_DIRECTORY, 0755);
+#endif
+    }
+    bool MeshCache::GetSourceStamp(const std::string& sourceFile, unsigned long long& size, long long& modified) {
+#if defined(_WIN32)
+        struct _stat64 fileInfo;
+        if (_stat64(sourceFile.c_str(), &fileInfo) != 0) {
+            return false;
+        }
+#else
+        struct stat fileInfo;
+        if (stat(sourceFile.c_str(), &fileInfo) != 0) {
+            return false;
+        }
+#endif
+        size = (unsigned long long)fileInfo.st_size;
+        modified = (long long)fileInfo.st_mtime;
+        return true;
+    }
+    unsigned int MeshCache::FormatHash() {
+        unsigned int layout[] = {
+            MESH_CACHE_VERSION,
+            (unsigned int)sizeof(gps::Vertex),
+            (unsigned int)offsetof(gps::Vertex, Normal),
+            (unsigned int)offsetof(gps::Vertex, TexCoords),
+            (unsigned int)sizeof(gps::CompactVertex),
+            (unsigned int)sizeof(gps::BvhNode),
+            (unsigned int)sizeof(gps::TriangleBvh::Triangle),
+            (unsigned int)sizeof(GLuint),
+            (unsigned int)sizeof(MeshCacheHeader),
+            (unsigned int)sizeof(MeshCacheEntry)
+        };
+        unsigned int hash = 2166136261u;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(layout);
+        for (size_t i = 0; i < sizeof(layout); i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+    const MeshCacheHeader* MeshCache::Validate(const gps::MappedFile& file, const std::string& sourceFile) {
+        if (file.Size() < sizeof(MeshCacheHeader)) {
+            return NULL;
+        }
+        const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.Data());
+        if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->formatHash != FormatHash()) {
+            return NULL;
+        }
+        unsigned long long sourceSize = 0;
+        long long sourceModified = 0;
+        if (GetSourceStamp(sourceFile, sourceSize, sourceModified)) {
+            if (sourceSize != header->sourceSize || sourceModified != header->sourceModified) {
+                return NULL;
+            }
+        }
+        if (file.Size() < sizeof(MeshCacheHeader) + header->meshCount * sizeof(MeshCacheEntry)) {
+            return NULL;
+        }
+        const MeshCacheEntry* entries = reinterpret_cast<const MeshCacheEntry*>(file.Data() + sizeof(MeshCacheHeader));
+        for (unsigned int i = 0; i < header->meshCount; i++) {
+            if (entries[i].vertexOffset + entries[i].vertexCount * sizeof(gps::Vertex) > file.Size() ||
+                entries[i].indexOffset + entries[i].indexCount * sizeof(GLuint) > file.Size() ||
+                entries[i].compactOffset + entries[i].compactCount * sizeof(gps::CompactVertex) > file.Size() ||
+                (entries[i].compactCount != 0 && entries[i].compactCount != entries[i].vertexCount) ||
+                entries[i].textureCount > (unsigned int)MESH_CACHE_MAX_TEXTURES ||
+                entries[i].lodCount > (unsigned int)MESH_CACHE_MAX_LODS) {
+                return NULL;
+            }
+            for (unsigned int l = 0; l < entries[i].lodCount; l++) {
+                if (entries[i].lods[l].indexOffset + entries[i].lods[l].indexCount * sizeof(GLuint) > file.Size()) {
+                    return NULL;
+                }
+            }
+        }
+        if (header->nodeOffset + header->nodeCount * sizeof(gps::BvhNode) > file.Size() ||
+            header->triangleOffset + header->triangleCount * sizeof(gps::TriangleBvh::Triangle) > file.Size() ||
+            header->hullOffset + header->hullCount * sizeof(glm::vec3) > file.Size()) {
+            return NULL;
+        }
+        return header;
+    }
+    bool MeshCache::Write(const std::string& sourceFile, MeshCacheHeader header, const std::vector<gps::MeshData>& meshes,
+                          const gps::TriangleBvh& collision, const gps::ConvexHull& hull) {
+        header.magic = MESH_CACHE_MAGIC;
+        header.version = MESH_CACHE_VERSION;
+        header.formatHash = FormatHash();
+        header.meshCount = (unsigned int)meshes.size();
+        if (!GetSourceStamp(sourceFile, header.sourceSize, header.sourceModified)) {
+            return false;
+        }
+        EnsureCacheDirectory();
+        std::vector<MeshCacheEntry> entries(meshes.size());
+        unsigned long long offset = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            MeshCacheEntry& entry = entries[i];
+            memset((void*)&entry, 0, sizeof(entry));
+            offset = AlignOffset(offset);
+            entry.vertexOffset = offset;
+            entry.vertexCount = meshes[i].vertexCount;
+            offset += entry.vertexCount * sizeof(gps::Vertex);
+            offset = AlignOffset(offset);
+            entry.indexOffset = offset;
+            entry.indexCount = meshes[i].indexCount;
+            offset += entry.indexCount * sizeof(GLuint);
+            if (meshes[i].compactData != NULL) {
+                offset = AlignOffset(offset);
+                entry.compactOffset = offset;
+                entry.compactCount = meshes[i].vertexCount;
+                entry.positionOffset = meshes[i].positionOffset;
+                entry.positionScale = meshes[i].positionScale;
+                offset += entry.compactCount * sizeof(gps::CompactVertex);
+            }
+            for (size_t l = 0; l < meshes[i].lods.size() && l < (size_t)MESH_CACHE_MAX_LODS; l++) {
+                offset = AlignOffset(offset);
+                entry.lods[l].indexOffset = offset;
+                entry.lods[l].indexCount = meshes[i].lods[l].indexCount;
+                entry.lods[l].error = meshes[i].lods[l].error;
+                offset += entry.lods[l].indexCount * sizeof(GLuint);
+                entry.lodCount++;
+            }
+            entry.ambient = meshes[i].material.ambient;
+            entry.diffuse = meshes[i].material.diffuse;
+            entry.specular = meshes[i].material.specular;
+            for (size_t t = 0; t < meshes[i].textures.size() && t < (size_t)MESH_CACHE_MAX_TEXTURES; t++) {
+                const gps::Texture& texture = meshes[i].textures[t];
+                if (texture.type.size() >= sizeof(entry.textures[t].type) || texture.path.size() >= sizeof(entry.textures[t].path)) {
+                    std::cout << "Mesh cache skipped, texture path too long : " << texture.path << std::endl;
+                    return false;
+                }
+                strncpy(entry.textures[t].type, texture.type.c_str(), sizeof(entry.textures[t].type) - 1);
+                strncpy(entry.textures[t].path, texture.path.c_str(), sizeof(entry.textures[t].path) - 1);
+                entry.textureCount++;
+            }
+        }
+        offset = AlignOffset(offset);
+        header.nodeOffset = offset;
+        header.nodeCount = collision.Nodes().size();
+        offset += header.nodeCount * sizeof(gps::BvhNode);
+        offset = AlignOffset(offset);
+        header.triangleOffset = offset;
+        header.triangleCount = collision.Triangles().size();
+        offset += header.triangleCount * sizeof(gps::TriangleBvh::Triangle);
+        offset = AlignOffset(offset);
+        header.hullOffset = offset;
+        header.hullCount = hull.Vertices().size();
+        header.hullMin = hull.BoundsMin();
+        header.hullMax = hull.BoundsMax();
+        std::string cachePath = CachePath(sourceFile, ".meshbin");
+        std::ostringstream temporaryName;
+        temporaryName << cachePath << ".tmp" << std::this_thread::get_id();
+        std::string temporaryPath = temporaryName.str();
+        std::ofstream out(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        const char zeros[16] = { 0 };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!entries.empty()) {
+            out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MeshCacheEntry));
+        }
+        for (size_t i = 0; i < meshes.size(); i++) {
+            out.write(zeros, (std::streamsize)(entries[i].vertexOffset - (unsigned long long)out.tellp()));
+            out.write(reinterpret_cast<const char*>(meshes[i].vertexData), entries[i].vertexCount * sizeof(gps::Vertex));
+            out.write(zeros, (std::streamsize)(entries[i].indexOffset - (unsigned long long)out.tellp()));
+            out.write(reinterpret_cast<const char*>(meshes[i].indexData), entries[i].indexCount * sizeof(GLuint));
+            if (entries[i].compactCount != 0) {
+                out.write(zeros, (std::streamsize)(entries[i].compactOffset - (unsigned long long)out.tellp()));
+                out.write(reinterpret_cast<const char*>(meshes[i].compactData), entries[i].compactCount * sizeof(gps::CompactVertex));
+            }
+            for (unsigned int l = 0; l < entries[i].lodCount; l++) {
+                out.write(zeros, (std::streamsize)(entries[i].lods[l].indexOffset - (unsigned long long)out.tellp()));
+                out.write(reinterpret_cast<const char*>(meshes[i].lods[l].indexData), entries[i].lods[l].indexCount * sizeof(GLuint));
+            }
+        }
+        out.write(zeros, (std::streamsize)(header.nodeOffset - (unsigned long long)out.tellp()));
+        out.write(reinterpret_cast<const char*>(collision.Nodes().data()), header.nodeCount * sizeof(gps::BvhNode));
+        out.write(zeros, (std::streamsize)(header.triangleOffset - (unsigned long long)out.tellp()));
+        out.write(reinterpret_cast<const char*>(collision.Triangles().data()), header.triangleCount * sizeof(gps::TriangleBvh::Triangle));
+        out.write(zeros, (std::streamsize)(header.hullOffset - (unsigned long long)out.tellp()));
+        out.write(reinterpret_cast<const char*>(hull.Vertices().data()), header.hullCount * sizeof(glm::vec3));
+        out.close();
+        if (!out) {
+            remove(temporaryPath.c_str());
+            return false;
+        }
+        remove(cachePath.c_str());
+        return rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+    }
+}
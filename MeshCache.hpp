@@ -0,0 +1,73 @@
+#ifndef MeshCache_hpp
+#define MeshCache_hpp
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+#include "TriangleBvh.hpp"
+#include "ConvexHull.hpp"
+#include <string>
+#include <vector>
+namespace gps {
+    const unsigned int MESH_CACHE_MAGIC = 0x4853454Du;
+    const unsigned int MESH_CACHE_VERSION = 4;
+    const int MESH_CACHE_MAX_TEXTURES = 3;
+    const int MESH_CACHE_MAX_LODS = 4;
+    struct MeshCacheHeader {
+        unsigned int magic;
+        unsigned int version;
+        unsigned int formatHash;
+        unsigned int meshCount;
+        unsigned long long sourceSize;
+        long long sourceModified;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        glm::vec3 hullMin;
+        glm::vec3 hullMax;
+        unsigned long long nodeOffset;
+        unsigned long long nodeCount;
+        unsigned long long triangleOffset;
+        unsigned long long triangleCount;
+        unsigned long long hullOffset;
+        unsigned long long hullCount;
+    };
+    struct MeshCacheTexture {
+        char type[32];
+        char path[256];
+    };
+    struct MeshCacheLod {
+        unsigned long long indexOffset;
+        unsigned long long indexCount;
+        float error;
+        unsigned int reserved;
+    };
+    struct MeshCacheEntry {
+        unsigned long long vertexOffset;
+        unsigned long long vertexCount;
+        unsigned long long indexOffset;
+        unsigned long long indexCount;
+        unsigned long long compactOffset;
+        unsigned long long compactCount;
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        glm::vec3 ambient;
+        glm::vec3 diffuse;
+        glm::vec3 specular;
+        unsigned int textureCount;
+        MeshCacheTexture textures[MESH_CACHE_MAX_TEXTURES];
+        unsigned int lodCount;
+        MeshCacheLod lods[MESH_CACHE_MAX_LODS];
+    };
+    class MeshCache {
+    public:
+        static std::string CachePath(const std::string& sourceFile, const std::string& extension);
+        static void EnsureCacheDirectory();
+        static bool GetSourceStamp(const std::string& sourceFile, unsigned long long& size, long long& modified);
+        static const MeshCacheHeader* Validate(const gps::MappedFile& file, const std::string& sourceFile);
+        static bool Write(const std::string& sourceFile, MeshCacheHeader header, const std::vector<gps::MeshData>& meshes,
+                          const gps::TriangleBvh& collision, const gps::ConvexHull& hull);
+    private:
+        static unsigned int FormatHash();
+    };
+}
+#endif
@@ -0,0 +1,489 @@
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+namespace gps {
+    static const int FORSYTH_CACHE_SIZE = 32;
+    static const float MAX_COMPACT_TEXCOORD = 2.0f;
+    static float VertexScore(int cachePosition, int liveTriangles) {
+        if (liveTriangles == 0) {
+            return -1.0f;
+        }
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                score = 0.75f;
+            } else {
+                score = powf(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+            }
+        }
+        return score + 2.0f * powf((float)liveTriangles, -0.5f);
+    }
+    static unsigned short FloatToHalf(float value) {
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        unsigned short sign = (unsigned short)((bits >> 16) & 0x8000);
+        int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+        unsigned int mantissa = bits & 0x7FFFFF;
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return sign;
+            }
+            mantissa |= 0x800000;
+            unsigned int shift = (unsigned int)(14 - exponent);
+            unsigned int half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1) {
+                half++;
+            }
+            return (unsigned short)(sign | half);
+        }
+        if (exponent >= 31) {
+            return (unsigned short)(sign | 0x7C00);
+        }
+        unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000) {
+            half++;
+        }
+        return (unsigned short)(sign | half);
+    }
+    static GLuint PackNormal(glm::vec3 normal) {
+        GLuint packed = 0;
+        for (int c = 0; c < 3; c++) {
+            int value = (int)floorf(glm::clamp(normal[c], -1.0f, 1.0f) * 511.0f + 0.5f);
+            packed |= ((GLuint)value & 0x3FFu) << (c * 10);
+        }
+        return packed;
+    }
+    struct Quadric {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, weight;
+    };
+    static void AddPlane(Quadric& q, glm::vec3 normal, float distance, float weight) {
+        double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        q.a2 += weight * a * a; q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+        q.b2 += weight * b * b; q.bc += weight * b * c; q.bd += weight * b * d;
+        q.c2 += weight * c * c; q.cd += weight * c * d; q.d2 += weight * d * d;
+        q.weight += weight;
+    }
+    static void AddQuadric(Quadric& q, const Quadric& other) {
+        q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+        q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+        q.c2 += other.c2; q.cd += other.cd; q.d2 += other.d2;
+        q.weight += other.weight;
+    }
+    static float QuadricError(const Quadric& q, glm::vec3 p) {
+        double x = p.x, y = p.y, z = p.z;
+        double error = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+                     + q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+                     + q.c2 * z * z + 2.0 * q.cd * z + q.d2;
+        return q.weight > 0.0 ? (float)sqrt(std::max(0.0, error) / q.weight) : 0.0f;
+    }
+    struct Collapse {
+        GLuint from;
+        GLuint to;
+        float error;
+    };
+    void MeshOptimizer::OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+        std::vector<int> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            liveTriangles[indices[i]]++;
+        }
+        std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+        }
+        std::vector<size_t> adjacency(triangleCount * 3);
+        std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = t;
+            }
+        }
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScore[v] = VertexScore(-1, liveTriangles[v]);
+        }
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        size_t bestTriangle = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            if (triangleScore[t] > triangleScore[bestTriangle]) {
+                bestTriangle = t;
+            }
+        }
+        std::vector<GLuint> output;
+        output.reserve(triangleCount * 3);
+        std::vector<GLuint> cache;
+        std::vector<GLuint> newCache;
+        size_t scanCursor = 0;
+        while (true) {
+            emitted[bestTriangle] = true;
+            newCache.clear();
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[bestTriangle * 3 + k];
+                output.push_back(v);
+                size_t begin = adjacencyOffset[v];
+                size_t end = begin + liveTriangles[v];
+                for (size_t j = begin; j < end; j++) {
+                    if (adjacency[j] == bestTriangle) {
+                        adjacency[j] = adjacency[end - 1];
+                        break;
+                    }
+                }
+                liveTriangles[v]--;
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+                    newCache.push_back(v);
+                }
+            }
+            for (size_t i = 0; i < cache.size(); i++) {
+                if (std::find(newCache.begin(), newCache.end(), cache[i]) == newCache.end()) {
+                    newCache.push_back(cache[i]);
+                }
+            }
+            for (size_t i = 0; i < newCache.size(); i++) {
+                GLuint v = newCache[i];
+                cachePosition[v] = i < (size_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+                vertexScore[v] = VertexScore(cachePosition[v], liveTriangles[v]);
+            }
+            if (output.size() == triangleCount * 3) {
+                break;
+            }
+            float bestScore = -1.0f;
+            bool found = false;
+            for (size_t i = 0; i < newCache.size(); i++) {
+                GLuint v = newCache[i];
+                size_t begin = adjacencyOffset[v];
+                size_t end = begin + liveTriangles[v];
+                for (size_t j = begin; j < end; j++) {
+                    size_t t = adjacency[j];
+                    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                        found = true;
+                    }
+                }
+            }
+            if (newCache.size() > (size_t)FORSYTH_CACHE_SIZE) {
+                newCache.resize((size_t)FORSYTH_CACHE_SIZE);
+            }
+            cache.swap(newCache);
+            if (!found) {
+                while (emitted[scanCursor]) {
+                    scanCursor++;
+                }
+                bestTriangle = scanCursor;
+            }
+        }
+        output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+        indices.swap(output);
+    }
+    void MeshOptimizer::OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<gps::Vertex>& vertices, float threshold) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+        VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+        std::vector<size_t> clusterStart;
+        std::vector<int> timestamp(vertices.size(), 0);
+        int time = FIFO_CACHE_SIZE + 1;
+        for (size_t t = 0; t < triangleCount; t++) {
+            int misses = 0;
+            for (int k = 0; k < 3; k++) {
+                GLuint v = indices[t * 3 + k];
+                if (time - timestamp[v] > FIFO_CACHE_SIZE) {
+                    timestamp[v] = time++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3) {
+                clusterStart.push_back(t);
+            }
+        }
+        clusterStart.push_back(triangleCount);
+        size_t clusterCount = clusterStart.size() - 1;
+        if (clusterCount < 2) {
+            return;
+        }
+        std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusterCount; c++) {
+            float clusterArea = 0.0f;
+            for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+                glm::vec3 p0 = vertices[indices[t * 3]].Position;
+                glm::vec3 p1 = vertices[indices[t * 3 + 1]].Position;
+                glm::vec3 p2 = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+                clusterCentroid[c] += centroid * area;
+                clusterNormal[c] += normal;
+                clusterArea += area;
+            }
+            meshCentroid += clusterCentroid[c];
+            meshArea += clusterArea;
+            if (clusterArea > 0.0f) {
+                clusterCentroid[c] /= clusterArea;
+            }
+        }
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+        std::vector<float> clusterSortKey(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            float normalLength = glm::length(clusterNormal[c]);
+            if (normalLength > 0.0f) {
+                clusterSortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / normalLength);
+            }
+        }
+        std::vector<size_t> clusterOrder(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++) {
+            clusterOrder[c] = c;
+        }
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKey](size_t a, size_t b) {
+            return clusterSortKey[a] > clusterSortKey[b];
+        });
+        std::vector<GLuint> output;
+        output.reserve(indices.size());
+        for (size_t i = 0; i < clusterCount; i++) {
+            size_t c = clusterOrder[i];
+            output.insert(output.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+        }
+        output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+        VertexCacheStats after = AnalyzeVertexCache(output, vertices.size());
+        if (after.acmr <= before.acmr * threshold) {
+            indices.swap(output);
+        }
+    }
+    void MeshOptimizer::OptimizeVertexFetch(std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices) {
+        const GLuint UNUSED = 0xFFFFFFFFu;
+        std::vector<GLuint> remap(vertices.size(), UNUSED);
+        std::vector<gps::Vertex> output;
+        output.reserve(vertices.size());
+        for (size_t i = 0; i < indices.size(); i++) {
+            GLuint v = indices[i];
+            if (remap[v] == UNUSED) {
+                remap[v] = (GLuint)output.size();
+                output.push_back(vertices[v]);
+            }
+            indices[i] = remap[v];
+        }
+        vertices.swap(output);
+    }
+    VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize) {
+        VertexCacheStats stats;
+        stats.triangles = indices.size() / 3;
+        stats.vertices = 0;
+        stats.misses = 0;
+        std::vector<int> timestamp(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        int time = cacheSize + 1;
+        for (size_t i = 0; i < stats.triangles * 3; i++) {
+            GLuint v = indices[i];
+            if (time - timestamp[v] > cacheSize) {
+                timestamp[v] = time++;
+                stats.misses++;
+            }
+            if (!referenced[v]) {
+                referenced[v] = true;
+                stats.vertices++;
+            }
+        }
+        stats.acmr = stats.triangles > 0 ? (float)stats.misses / stats.triangles : 0.0f;
+        stats.atvr = stats.vertices > 0 ? (float)stats.misses / stats.vertices : 0.0f;
+        return stats;
+    }
+    float MeshOptimizer::Simplify(const gps::Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount,
+                                  size_t targetIndexCount, std::vector<GLuint>& output) {
+        output.assign(indices, indices + indexCount);
+        std::vector<GLuint> sorted(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            sorted[v] = (GLuint)v;
+        }
+        std::sort(sorted.begin(), sorted.end(), [vertices](GLuint a, GLuint b) {
+            const glm::vec3& pa = vertices[a].Position;
+            const glm::vec3& pb = vertices[b].Position;
+            if (pa.x != pb.x) return pa.x < pb.x;
+            if (pa.y != pb.y) return pa.y < pb.y;
+            return pa.z < pb.z;
+        });
+        std::vector<GLuint> position(vertexCount);
+        std::vector<bool> locked(vertexCount, false);
+        for (size_t begin = 0; begin < vertexCount; ) {
+            size_t end = begin + 1;
+            while (end < vertexCount && vertices[sorted[end]].Position == vertices[sorted[begin]].Position) {
+                end++;
+            }
+            for (size_t i = begin; i < end; i++) {
+                position[sorted[i]] = sorted[begin];
+                locked[sorted[i]] = end - begin > 1;
+            }
+            begin = end;
+        }
+        std::vector<unsigned long long> edges;
+        edges.reserve(indexCount);
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            for (int e = 0; e < 3; e++) {
+                GLuint a = position[output[i + e]];
+                GLuint b = position[output[i + (e + 1) % 3]];
+                edges.push_back(((unsigned long long)a << 32) | b);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<bool> lockedPosition(vertexCount, false);
+        for (size_t i = 0; i < edges.size(); i++) {
+            unsigned long long reverse = (edges[i] << 32) | (edges[i] >> 32);
+            if (!std::binary_search(edges.begin(), edges.end(), reverse)) {
+                lockedPosition[(GLuint)(edges[i] >> 32)] = true;
+                lockedPosition[(GLuint)(edges[i] & 0xFFFFFFFFu)] = true;
+            }
+        }
+        std::vector<Quadric> quadrics(vertexCount);
+        memset((void*)quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            glm::vec3 p0 = vertices[output[i]].Position;
+            glm::vec3 p1 = vertices[output[i + 1]].Position;
+            glm::vec3 p2 = vertices[output[i + 2]].Position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            if (area <= 0.0f) {
+                continue;
+            }
+            normal /= area;
+            for (int k = 0; k < 3; k++) {
+                AddPlane(quadrics[position[output[i + k]]], normal, -glm::dot(normal, p0), area);
+            }
+        }
+        float maxError = 0.0f;
+        std::vector<GLuint> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<GLuint> adjacencyOffset(vertexCount + 1);
+        std::vector<GLuint> adjacency;
+        std::vector<Collapse> collapses;
+        while (output.size() > targetIndexCount) {
+            size_t triangleCount = output.size() / 3;
+            std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+            for (size_t i = 0; i < output.size(); i++) {
+                adjacencyOffset[output[i] + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                adjacencyOffset[v + 1] += adjacencyOffset[v];
+            }
+            adjacency.resize(output.size());
+            std::vector<GLuint> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < output.size(); i++) {
+                adjacency[fill[output[i]]++] = (GLuint)(i / 3);
+            }
+            collapses.clear();
+            for (size_t i = 0; i < output.size(); i += 3) {
+                for (int e = 0; e < 3; e++) {
+                    GLuint from = output[i + e];
+                    GLuint to = output[i + (e + 1) % 3];
+                    if (locked[from] || lockedPosition[position[from]] || position[from] == position[to]) {
+                        continue;
+                    }
+                    Quadric q = quadrics[position[from]];
+                    AddQuadric(q, quadrics[position[to]]);
+                    Collapse collapse = { from, to, QuadricError(q, vertices[to].Position) };
+                    collapses.push_back(collapse);
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+                return a.error < b.error;
+            });
+            for (size_t v = 0; v < vertexCount; v++) {
+                remap[v] = (GLuint)v;
+            }
+            std::fill(touched.begin(), touched.end(), false);
+            size_t removed = 0;
+            size_t applied = 0;
+            for (size_t c = 0; c < collapses.size() && (triangleCount - removed) * 3 > targetIndexCount; c++) {
+                const Collapse& collapse = collapses[c];
+                if (touched[position[collapse.from]] || touched[position[collapse.to]]) {
+                    continue;
+                }
+                glm::vec3 target = vertices[collapse.to].Position;
+                bool flipped = false;
+                size_t shared = 0;
+                for (GLuint t = adjacencyOffset[collapse.from]; t < adjacencyOffset[collapse.from + 1] && !flipped; t++) {
+                    const GLuint* triangle = &output[adjacency[t] * 3];
+                    if (position[triangle[0]] == position[collapse.to] || position[triangle[1]] == position[collapse.to] || position[triangle[2]] == position[collapse.to]) {
+                        shared++;
+                        continue;
+                    }
+                    glm::vec3 before[3];
+                    glm::vec3 after[3];
+                    for (int k = 0; k < 3; k++) {
+                        before[k] = vertices[triangle[k]].Position;
+                        after[k] = triangle[k] == collapse.from ? target : before[k];
+                    }
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    flipped = glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter);
+                }
+                if (flipped) {
+                    continue;
+                }
+                for (GLuint t = adjacencyOffset[collapse.from]; t < adjacencyOffset[collapse.from + 1]; t++) {
+                    const GLuint* triangle = &output[adjacency[t] * 3];
+                    for (int k = 0; k < 3; k++) {
+                        touched[position[triangle[k]]] = true;
+                    }
+                }
+                remap[collapse.from] = collapse.to;
+                AddQuadric(quadrics[position[collapse.to]], quadrics[position[collapse.from]]);
+                maxError = std::max(maxError, collapse.error);
+                removed += shared;
+                applied++;
+            }
+            if (applied == 0) {
+                break;
+            }
+            size_t write = 0;
+            for (size_t i = 0; i < output.size(); i += 3) {
+                GLuint a = remap[output[i]];
+                GLuint b = remap[output[i + 1]];
+                GLuint c = remap[output[i + 2]];
+                if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c]) {
+                    continue;
+                }
+                output[write++] = a;
+                output[write++] = b;
+                output[write++] = c;
+            }
+            output.resize(write);
+        }
+        return maxError;
+    }
+    bool MeshOptimizer::QuantizeVertices(const gps::Vertex* vertices, size_t vertexCount, glm::vec3 boundsMin, glm::vec3 boundsMax,
+                                         std::vector<gps::CompactVertex>& output, glm::vec3& positionOffset, glm::vec3& positionScale) {
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (fabsf(vertices[v].TexCoords.x) > MAX_COMPACT_TEXCOORD || fabsf(vertices[v].TexCoords.y) > MAX_COMPACT_TEXCOORD) {
+                return false;
+            }
+        }
+        positionOffset = boundsMin;
+        positionScale = boundsMax - boundsMin;
+        output.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            gps::CompactVertex& vertex = output[v];
+            for (int c = 0; c < 3; c++) {
+                float extent = boundsMax[c] - boundsMin[c];
+                float normalized = extent > 0.0f ? (vertices[v].Position[c] - boundsMin[c]) / extent : 0.0f;
+                vertex.Position[c] = (unsigned short)(glm::clamp(normalized, 0.0f, 1.0f) * 65535.0f + 0.5f);
+            }
+            vertex.Position[3] = 0;
+            vertex.Normal = PackNormal(vertices[v].Normal);
+            vertex.TexCoords[0] = FloatToHalf(vertices[v].TexCoords.x);
+            vertex.TexCoords[1] = FloatToHalf(vertices[v].TexCoords.y);
+        }
+        return true;
+    }
+}
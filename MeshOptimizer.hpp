@@ -0,0 +1,26 @@
+#ifndef MeshOptimizer_hpp
+#define MeshOptimizer_hpp
+#include "Mesh.hpp"
+#include <vector>
+namespace gps {
+    struct VertexCacheStats {
+        size_t triangles;
+        size_t vertices;
+        size_t misses;
+        float acmr;
+        float atvr;
+    };
+    class MeshOptimizer {
+    public:
+        static const int FIFO_CACHE_SIZE = 16;
+        static void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount);
+        static void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<gps::Vertex>& vertices, float threshold);
+        static void OptimizeVertexFetch(std::vector<gps::Vertex>& vertices, std::vector<GLuint>& indices);
+        static float Simplify(const gps::Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount,
+                              size_t targetIndexCount, std::vector<GLuint>& output);
+        static bool QuantizeVertices(const gps::Vertex* vertices, size_t vertexCount, glm::vec3 boundsMin, glm::vec3 boundsMax,
+                                     std::vector<gps::CompactVertex>& output, glm::vec3& positionOffset, glm::vec3& positionScale);
+        static VertexCacheStats AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize = FIFO_CACHE_SIZE);
+    };
+}
+#endif
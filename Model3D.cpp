@@ -1,18 +1,138 @@
 #include "Model3D.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshCache.hpp"
+#include "TextureCache.hpp"
+#include "GeometryArena.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
 namespace gps {
+	static const size_t MIN_LOD_TRIANGLES = 512;
+	static const float LOD_TRIANGLE_RATIOS[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+	struct VertexHash {
+		size_t operator()(const gps::Vertex& vertex) const {
+			const unsigned int* words = reinterpret_cast<const unsigned int*>(&vertex);
+			size_t hash = 2166136261u;
+			for (size_t i = 0; i < sizeof(gps::Vertex) / sizeof(unsigned int); i++) {
+				hash = (hash ^ words[i]) * 16777619u;
+			}
+			return hash;
+		}
+	};
+	struct VertexEqual {
+		bool operator()(const gps::Vertex& a, const gps::Vertex& b) const {
+			return memcmp(&a, &b, sizeof(gps::Vertex)) == 0;
+		}
+	};
 	void Model3D::LoadModel(std::string fileName) {
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		gps::AssetLoader inlineLoader;
+		Load(fileName, basePath, inlineLoader);
 	}
     void Model3D::LoadModel(std::string fileName, std::string basePath)	{
-		ReadOBJ(fileName, basePath);
+		gps::AssetLoader inlineLoader;
+		Load(fileName, basePath, inlineLoader);
+	}
+	void Model3D::LoadModel(std::string fileName, gps::AssetLoader& loader) {
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+		Load(fileName, basePath, loader);
+	}
+	void Model3D::Load(std::string fileName, std::string basePath, gps::AssetLoader& loader) {
+		bool created = false;
+		resource = gps::AssetRegistry::AcquireModel(fileName, created);
+		if (!created) {
+			std::cout << "Sharing already loaded model : " << fileName << std::endl;
+			gps::AssetRegistry::WhenReady(resource, [this]() {
+				Instantiate();
+			});
+			return;
+		}
+		std::shared_ptr<gps::StagedModel> staged = std::make_shared<gps::StagedModel>();
+		gps::AssetLoader* uploadQueue = &loader;
+		loader.Submit([this, fileName, basePath, staged, uploadQueue]() {
+			StageModel(fileName, basePath, *staged);
+			uploadQueue->QueueUpload([this, staged]() {
+				UploadStaged(*staged);
+			});
+		});
 	}
-	void Model3D::Draw(gps::Shader shaderProgram) {
+	void Model3D::Draw(gps::Shader& shaderProgram) {
 		for (int i = 0; i < meshes.size(); i++)
 			meshes[i].Draw(shaderProgram);
 	}
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
-        std::cout << "Loading : " << fileName << std::endl;
+	void Model3D::DrawInstanced(gps::Shader& shaderProgram, const std::vector<gps::InstanceData>& instances) {
+		if (instances.empty())
+			return;
+		UploadInstances(instances);
+		shaderProgram.useShaderProgram();
+		shaderProgram.setInt(gps::Shader::UNIFORM_IS_INSTANCED, 1);
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i].DrawInstanced(shaderProgram, (GLsizei)instances.size());
+		shaderProgram.setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+	}
+	void Model3D::UploadInstances(const std::vector<gps::InstanceData>& instances) {
+		UploadInstances(instances, 0);
+	}
+	void Model3D::UploadInstances(const std::vector<gps::InstanceData>& instances, int lod) {
+		GLuint& buffer = lod == 0 ? instanceVBO : lods[lod - 1].instanceVBO;
+		if (buffer == 0) {
+			glGenBuffers(1, &buffer);
+			std::vector<gps::Mesh>& lodMeshes = LodMeshes(lod);
+			for (size_t i = 0; i < lodMeshes.size(); i++)
+				lodMeshes[i].SetupInstanceAttributes(buffer);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(gps::InstanceData), instances.data(), GL_STREAM_DRAW);
+	}
+	int Model3D::LodCount() const {
+		return 1 + (int)lods.size();
+	}
+	float Model3D::LodError(int lod) const {
+		if (lod == 0 || boundsRadius <= 0.0f) {
+			return 0.0f;
+		}
+		return lods[lod - 1].error / boundsRadius;
+	}
+	std::vector<gps::Mesh>& Model3D::LodMeshes(int lod) {
+		return lod == 0 ? meshes : lods[lod - 1].meshes;
+	}
+	const gps::TriangleBvh* Model3D::CollisionMesh() const {
+		return collision.get();
+	}
+	const gps::ConvexHull* Model3D::CollisionHull() const {
+		return hull.get();
+	}
+	void Model3D::StageModel(std::string fileName, std::string basePath, gps::StagedModel& staged) {
+		std::ostringstream log;
+		log << "Loading : " << fileName << std::endl;
+		staged.log = log.str();
+		std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+		bool cooked = StageCooked(fileName, staged);
+		if (!cooked) {
+			StageOBJ(fileName, basePath, staged);
+			BuildLods(staged);
+			BuildCollision(staged);
+			QuantizeMeshes(staged);
+		}
+		StageTextures(staged);
+		if (!cooked) {
+			WriteCooked(fileName, staged);
+		}
+		double stageMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		log.str("");
+		log << (cooked ? "Loaded cooked mesh cache" : "Parsed OBJ") << " and decoded " << staged.textures.size() << " textures in " << stageMs << " ms" << std::endl;
+		staged.log += log.str();
+	}
+	void Model3D::StageOBJ(std::string fileName, std::string basePath, gps::StagedModel& staged) {
+		std::ostringstream log;
+		std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+		size_t cornerCount = 0;
+		size_t weldedCount = 0;
+		size_t indexCount = 0;
+		gps::VertexCacheStats cacheBefore = { 0, 0, 0, 0.0f, 0.0f };
+		gps::VertexCacheStats cacheAfter = { 0, 0, 0, 0.0f, 0.0f };
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -25,12 +145,15 @@ namespace gps {
 		if (!ret) {
 			exit(1);
 		}
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
+		log << "# of shapes    : " << shapes.size() << std::endl;
+		log << "# of materials : " << materials.size() << std::endl;
+		staged.meshes.resize(shapes.size());
 		for (size_t s = 0; s < shapes.size(); s++) {
-			std::vector<gps::Vertex> vertices;
-			std::vector<GLuint> indices;
-			std::vector<gps::Texture> textures;
+			gps::MeshData& mesh = staged.meshes[s];
+			std::vector<gps::Vertex>& vertices = mesh.vertices;
+			std::vector<GLuint>& indices = mesh.indices;
+			std::unordered_map<gps::Vertex, GLuint, VertexHash, VertexEqual> uniqueVertices;
+			uniqueVertices.reserve(shapes[s].mesh.indices.size());
 			size_t index_offset = 0;
 			for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
 				int fv = shapes[s].mesh.num_face_vertices[f];
@@ -55,13 +178,36 @@ namespace gps {
 					currentVertex.Position = vertexPosition;
 					currentVertex.Normal = vertexNormal;
 					currentVertex.TexCoords = vertexTexCoords;
-					vertices.push_back(currentVertex);
-					indices.push_back((GLuint)(index_offset + v));
+					std::pair<std::unordered_map<gps::Vertex, GLuint, VertexHash, VertexEqual>::iterator, bool> inserted =
+						uniqueVertices.insert(std::make_pair(currentVertex, (GLuint)vertices.size()));
+					if (inserted.second) {
+						vertices.push_back(currentVertex);
+					}
+					indices.push_back(inserted.first->second);
 				}
 				index_offset += fv;
 			}
+			gps::VertexCacheStats meshBefore = gps::MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+			gps::MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+			gps::MeshOptimizer::OptimizeOverdraw(indices, vertices, 1.05f);
+			gps::MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+			gps::VertexCacheStats meshAfter = gps::MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+			cacheBefore.triangles += meshBefore.triangles;
+			cacheBefore.vertices += meshBefore.vertices;
+			cacheBefore.misses += meshBefore.misses;
+			cacheAfter.triangles += meshAfter.triangles;
+			cacheAfter.vertices += meshAfter.vertices;
+			cacheAfter.misses += meshAfter.misses;
+			cornerCount += index_offset;
+			weldedCount += vertices.size();
+			indexCount += indices.size();
+			mesh.vertexData = vertices.data();
+			mesh.vertexCount = vertices.size();
+			mesh.indexData = indices.data();
+			mesh.indexCount = indices.size();
+			mesh.compactData = NULL;
 			size_t a = shapes[s].mesh.material_ids.size();
-            gps::Material currentMaterial;
+            gps::Material& currentMaterial = mesh.material;
             currentMaterial.ambient = glm::vec3(1.0f);
             currentMaterial.diffuse = glm::vec3(1.0f);
             currentMaterial.specular = glm::vec3(1.0f);
@@ -71,104 +217,316 @@ namespace gps {
 					currentMaterial.ambient = glm::vec3(materials[materialId].ambient[0], materials[materialId].ambient[1], materials[materialId].ambient[2]);
 					currentMaterial.diffuse = glm::vec3(materials[materialId].diffuse[0], materials[materialId].diffuse[1], materials[materialId].diffuse[2]);
 					currentMaterial.specular = glm::vec3(materials[materialId].specular[0], materials[materialId].specular[1], materials[materialId].specular[2]);
-					std::string ambientTexturePath = materials[materialId].ambient_texname;
-					if (!ambientTexturePath.empty()) {
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
-						textures.push_back(currentTexture);
+					const std::string texturePaths[3] = {
+						materials[materialId].ambient_texname,
+						materials[materialId].diffuse_texname,
+						materials[materialId].specular_texname
+					};
+					const char* textureTypes[3] = { "ambientTexture", "diffuseTexture", "specularTexture" };
+					for (int t = 0; t < 3; t++) {
+						if (!texturePaths[t].empty()) {
+							gps::Texture currentTexture;
+							currentTexture.id = 0;
+							currentTexture.type = textureTypes[t];
+							currentTexture.path = basePath + texturePaths[t];
+							currentTexture.samplerUniform = -1;
+							mesh.textures.push_back(currentTexture);
+						}
 					}
-					std::string diffuseTexturePath = materials[materialId].diffuse_texname;
-					if (!diffuseTexturePath.empty()) {
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
-						textures.push_back(currentTexture);
+				}
+			}
+		}
+		ComputeBounds(staged);
+		double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		size_t bytesBefore = cornerCount * (sizeof(gps::Vertex) + sizeof(GLuint));
+		size_t bytesAfter = weldedCount * sizeof(gps::Vertex) + indexCount * sizeof(GLuint);
+		log << "Welded " << cornerCount << " -> " << weldedCount << " vertices in " << loadMs << " ms, "
+			<< bytesBefore / 1024 << " KB -> " << bytesAfter / 1024 << " KB" << std::endl;
+		if (cacheBefore.triangles > 0 && cacheBefore.vertices > 0) {
+			log << "Vertex cache (FIFO " << gps::MeshOptimizer::FIFO_CACHE_SIZE << "): ACMR "
+				<< (float)cacheBefore.misses / cacheBefore.triangles << " -> " << (float)cacheAfter.misses / cacheAfter.triangles
+				<< ", ATVR " << (float)cacheBefore.misses / cacheBefore.vertices << " -> " << (float)cacheAfter.misses / cacheAfter.vertices << std::endl;
+		}
+		staged.log += log.str();
+	}
+	bool Model3D::StageCooked(std::string fileName, gps::StagedModel& staged) {
+		std::shared_ptr<gps::MappedFile> file = std::make_shared<gps::MappedFile>();
+		if (!file->Open(gps::MeshCache::CachePath(fileName, ".meshbin"))) {
+			return false;
+		}
+		const gps::MeshCacheHeader* header = gps::MeshCache::Validate(*file, fileName);
+		if (header == NULL) {
+			staged.log += "Mesh cache is stale, rebuilding\n";
+			return false;
+		}
+		const gps::MeshCacheEntry* entries = reinterpret_cast<const gps::MeshCacheEntry*>(file->Data() + sizeof(gps::MeshCacheHeader));
+		staged.meshes.resize(header->meshCount);
+		for (unsigned int i = 0; i < header->meshCount; i++) {
+			const gps::MeshCacheEntry& entry = entries[i];
+			gps::MeshData& mesh = staged.meshes[i];
+			for (unsigned int t = 0; t < entry.textureCount; t++) {
+				gps::Texture currentTexture;
+				currentTexture.id = 0;
+				currentTexture.type = entry.textures[t].type;
+				currentTexture.path = entry.textures[t].path;
+				currentTexture.samplerUniform = -1;
+				mesh.textures.push_back(currentTexture);
+			}
+			mesh.vertexData = reinterpret_cast<const gps::Vertex*>(file->Data() + entry.vertexOffset);
+			mesh.vertexCount = (size_t)entry.vertexCount;
+			mesh.indexData = reinterpret_cast<const GLuint*>(file->Data() + entry.indexOffset);
+			mesh.indexCount = (size_t)entry.indexCount;
+			mesh.compactData = entry.compactCount != 0 ? reinterpret_cast<const gps::CompactVertex*>(file->Data() + entry.compactOffset) : NULL;
+			mesh.positionOffset = entry.positionOffset;
+			mesh.positionScale = entry.positionScale;
+			for (unsigned int l = 0; l < entry.lodCount; l++) {
+				gps::MeshLodData lod = { reinterpret_cast<const GLuint*>(file->Data() + entry.lods[l].indexOffset), (size_t)entry.lods[l].indexCount, entry.lods[l].error };
+				mesh.lods.push_back(lod);
+			}
+			mesh.material.ambient = entry.ambient;
+			mesh.material.diffuse = entry.diffuse;
+			mesh.material.specular = entry.specular;
+		}
+		staged.boundsMin = header->boundsMin;
+		staged.boundsMax = header->boundsMax;
+		staged.boundsCenter = header->boundsCenter;
+		staged.boundsRadius = header->boundsRadius;
+		staged.collision = std::make_shared<gps::TriangleBvh>();
+		staged.collision->Load(reinterpret_cast<const gps::BvhNode*>(file->Data() + header->nodeOffset), (size_t)header->nodeCount,
+			reinterpret_cast<const gps::TriangleBvh::Triangle*>(file->Data() + header->triangleOffset), (size_t)header->triangleCount);
+		staged.hull = std::make_shared<gps::ConvexHull>();
+		staged.hull->Load(reinterpret_cast<const glm::vec3*>(file->Data() + header->hullOffset), (size_t)header->hullCount, header->hullMin, header->hullMax);
+		staged.cookedFile = file;
+		return true;
+	}
+	void Model3D::StageTextures(gps::StagedModel& staged) {
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			for (size_t t = 0; t < staged.meshes[i].textures.size(); t++) {
+				gps::Texture& meshTexture = staged.meshes[i].textures[t];
+				for (size_t j = 0; j < staged.textures.size(); j++) {
+					if (staged.textures[j].path == meshTexture.path) {
+						meshTexture.resource = staged.textures[j].resource;
+						break;
 					}
-					std::string specularTexturePath = materials[materialId].specular_texname;
-					if (!specularTexturePath.empty()) {
-						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
-						textures.push_back(currentTexture);
+				}
+				if (meshTexture.resource) {
+					continue;
+				}
+				gps::TextureClaim claim = gps::AssetRegistry::ClaimTexture(meshTexture.path);
+				meshTexture.resource = claim.resource;
+				gps::StagedTexture texture;
+				texture.path = meshTexture.path;
+				texture.resource = claim.resource;
+				if (claim.load) {
+					std::shared_ptr<gps::MipChain> mips = std::make_shared<gps::MipChain>();
+					gps::DecodedImage& image = mips->image;
+					if (gps::TextureCache::Load(texture.path, true, *mips)) {
+						texture.mips = mips;
+					} else if ((claim.fileData.empty() && !gps::AssetRegistry::ReadFile(texture.path, claim.fileData)) ||
+							!gps::AssetLoader::DecodeImage(claim.fileData.data(), claim.fileData.size(), 4, true, image)) {
+						staged.log += "ERROR: could not load " + texture.path + "\n";
+					} else {
+						if ((image.width & (image.width - 1)) != 0 || (image.height & (image.height - 1)) != 0) {
+							staged.log += "WARNING: texture " + texture.path + " is not power-of-2 dimensions\n";
+						}
+						gps::TextureStreamer::BuildMipChain(*mips, true);
+						gps::TextureCache::Cook(texture.path, true, *mips, claim.contentHash);
+						texture.mips = mips;
 					}
 				}
+				staged.textures.push_back(texture);
 			}
-			meshes.push_back(gps::Mesh(vertices, indices, textures, currentMaterial.ambient, currentMaterial.diffuse, currentMaterial.specular));
 		}
 	}
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
-			for (int i = 0; i < loadedTextures.size(); i++) {
-				if (loadedTextures[i].path == path)	{
-					return loadedTextures[i];
+	void Model3D::WriteCooked(std::string fileName, const gps::StagedModel& staged) {
+		gps::MeshCacheHeader header;
+		memset((void*)&header, 0, sizeof(header));
+		header.boundsMin = staged.boundsMin;
+		header.boundsMax = staged.boundsMax;
+		header.boundsCenter = staged.boundsCenter;
+		header.boundsRadius = staged.boundsRadius;
+		if (!gps::MeshCache::Write(fileName, header, staged.meshes, *staged.collision, *staged.hull)) {
+			std::cout << "Could not write mesh cache for " << fileName << std::endl;
+		}
+	}
+	void Model3D::ComputeBounds(gps::StagedModel& staged) {
+		bool first = true;
+		staged.boundsMin = glm::vec3(0.0f);
+		staged.boundsMax = glm::vec3(0.0f);
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			for (size_t v = 0; v < staged.meshes[i].vertexCount; v++) {
+				glm::vec3 position = staged.meshes[i].vertexData[v].Position;
+				if (first) {
+					staged.boundsMin = position;
+					staged.boundsMax = position;
+					first = false;
 				}
+				staged.boundsMin = glm::min(staged.boundsMin, position);
+				staged.boundsMax = glm::max(staged.boundsMax, position);
 			}
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
-			loadedTextures.push_back(currentTexture);
-			return currentTexture;
-		}
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
-		int x, y, n;
-		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
-		if (!image_data) {
-			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
 		}
-		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
-			fprintf(
-				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
-			);
-		}
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
-		for (int row = 0; row < half_height; row++) {
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
-			for (int col = 0; col < width_in_bytes; col++) {
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
-			}
-		}
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB, 
-			x,
-			y,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			image_data
-		);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		return textureID;
+		staged.boundsCenter = (staged.boundsMin + staged.boundsMax) * 0.5f;
+		staged.boundsRadius = 0.0f;
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			for (size_t v = 0; v < staged.meshes[i].vertexCount; v++) {
+				staged.boundsRadius = glm::max(staged.boundsRadius, glm::distance(staged.boundsCenter, staged.meshes[i].vertexData[v].Position));
+			}
+		}
+	}
+	void Model3D::BuildLods(gps::StagedModel& staged) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::ostringstream log;
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			gps::MeshData& mesh = staged.meshes[i];
+			size_t triangleCount = mesh.indexCount / 3;
+			if (triangleCount < MIN_LOD_TRIANGLES) {
+				continue;
+			}
+			std::vector<float> errors;
+			const GLuint* source = mesh.indexData;
+			size_t sourceCount = mesh.indexCount;
+			log << "LODs for mesh " << i << " : " << triangleCount;
+			for (size_t l = 0; l < sizeof(LOD_TRIANGLE_RATIOS) / sizeof(LOD_TRIANGLE_RATIOS[0]); l++) {
+				size_t target = std::max((size_t)1, (size_t)(triangleCount * LOD_TRIANGLE_RATIOS[l])) * 3;
+				std::vector<GLuint> simplified;
+				float error = gps::MeshOptimizer::Simplify(mesh.vertexData, mesh.vertexCount, source, sourceCount, target, simplified);
+				if (simplified.empty() || simplified.size() * 10 > sourceCount * 9) {
+					break;
+				}
+				gps::MeshOptimizer::OptimizeVertexCache(simplified, mesh.vertexCount);
+				log << " -> " << simplified.size() / 3;
+				mesh.lodIndices.push_back(std::vector<GLuint>());
+				mesh.lodIndices.back().swap(simplified);
+				errors.push_back(errors.empty() ? error : std::max(error, errors.back() + error));
+				source = mesh.lodIndices.back().data();
+				sourceCount = mesh.lodIndices.back().size();
+			}
+			for (size_t l = 0; l < mesh.lodIndices.size(); l++) {
+				gps::MeshLodData lod = { mesh.lodIndices[l].data(), mesh.lodIndices[l].size(), errors[l] };
+				mesh.lods.push_back(lod);
+			}
+			log << " triangles" << std::endl;
+		}
+		double lodMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		log << "Built LODs in " << lodMs << " ms" << std::endl;
+		staged.log += log.str();
+	}
+	void Model3D::BuildCollision(gps::StagedModel& staged) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::vector<glm::vec3> positions;
+		std::vector<GLuint> indices;
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			const gps::MeshData& mesh = staged.meshes[i];
+			GLuint baseVertex = (GLuint)positions.size();
+			for (size_t v = 0; v < mesh.vertexCount; v++) {
+				positions.push_back(mesh.vertexData[v].Position);
+			}
+			for (size_t n = 0; n < mesh.indexCount; n++) {
+				indices.push_back(baseVertex + mesh.indexData[n]);
+			}
+		}
+		staged.collision = std::make_shared<gps::TriangleBvh>();
+		staged.collision->Build(positions, indices);
+		staged.hull = std::make_shared<gps::ConvexHull>();
+		staged.hull->Build(positions);
+		double bvhMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		std::ostringstream log;
+		log << "Built collision BVH: " << staged.collision->TriangleCount() << " triangles, " << staged.collision->NodeCount() << " nodes, "
+			<< staged.hull->VertexCount() << " hull vertices in " << bvhMs << " ms" << std::endl;
+		staged.log += log.str();
+	}
+	void Model3D::QuantizeMeshes(gps::StagedModel& staged) {
+		size_t bytesBefore = 0;
+		size_t bytesAfter = 0;
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			gps::MeshData& mesh = staged.meshes[i];
+			bytesBefore += mesh.vertexCount * sizeof(gps::Vertex);
+			if (gps::MeshOptimizer::QuantizeVertices(mesh.vertexData, mesh.vertexCount, staged.boundsMin, staged.boundsMax,
+					mesh.compactVertices, mesh.positionOffset, mesh.positionScale)) {
+				mesh.compactData = mesh.compactVertices.data();
+				bytesAfter += mesh.vertexCount * sizeof(gps::CompactVertex);
+			} else {
+				mesh.compactData = NULL;
+				bytesAfter += mesh.vertexCount * sizeof(gps::Vertex);
+			}
+		}
+		std::ostringstream log;
+		log << "Quantised vertices " << bytesBefore / 1024 << " KB -> " << bytesAfter / 1024 << " KB" << std::endl;
+		staged.log += log.str();
+	}
+	void Model3D::UploadStaged(gps::StagedModel& staged) {
+		std::cout << staged.log;
+		for (size_t i = 0; i < staged.textures.size(); i++) {
+			if (staged.textures[i].mips) {
+				gps::TextureResource& texture = *staged.textures[i].resource;
+				const gps::MipChain& chain = *staged.textures[i].mips;
+				texture.bytes = gps::TextureStreamer::ChainBytes(chain);
+				gps::TextureStreamer::Enqueue(texture.Name(), staged.textures[i].resource, GL_SRGB, GL_RGBA, staged.textures[i].mips);
+			}
+		}
+		for (size_t i = 0; i < staged.meshes.size(); i++) {
+			gps::MeshData& mesh = staged.meshes[i];
+			gps::MeshResource meshResource;
+			meshResource.geometry = std::make_shared<gps::MeshGeometry>(mesh);
+			meshResource.material = mesh.material;
+			meshResource.textures = mesh.textures;
+			resource->meshes.push_back(meshResource);
+		}
+		resource->boundsMin = staged.boundsMin;
+		resource->boundsMax = staged.boundsMax;
+		resource->boundsCenter = staged.boundsCenter;
+		resource->boundsRadius = staged.boundsRadius;
+		resource->collision = staged.collision;
+		resource->hull = staged.hull;
+		staged.meshes.clear();
+		staged.textures.clear();
+		staged.cookedFile.reset();
+		Instantiate();
+		gps::AssetRegistry::MarkReady(resource);
+	}
+	void Model3D::Instantiate() {
+		for (size_t i = 0; i < resource->meshes.size(); i++) {
+			const gps::MeshResource& meshResource = resource->meshes[i];
+			std::vector<gps::Texture> textures = meshResource.textures;
+			for (size_t t = 0; t < textures.size(); t++) {
+				textures[t].id = textures[t].resource->Name();
+				textures[t].samplerUniform = gps::Shader::internUniform(textures[t].type);
+			}
+			meshes.push_back(gps::Mesh(meshResource.geometry, textures, meshResource.material.ambient, meshResource.material.diffuse, meshResource.material.specular));
+		}
+		size_t lodCount = 1;
+		for (size_t i = 0; i < resource->meshes.size(); i++) {
+			lodCount = std::max(lodCount, resource->meshes[i].geometry->lods.size());
+		}
+		lodCount = std::min(lodCount, (size_t)MAX_LODS);
+		for (size_t l = 1; l < lodCount; l++) {
+			gps::ModelLod lod;
+			lod.instanceVBO = 0;
+			lod.error = 0.0f;
+			for (size_t i = 0; i < meshes.size(); i++) {
+				const gps::MeshGeometry& geometry = *meshes[i].geometry;
+				lod.meshes.push_back(gps::Mesh(meshes[i].geometry, meshes[i].textures, meshes[i].Ka, meshes[i].Kd, meshes[i].Ks, l));
+				lod.error = std::max(lod.error, geometry.lods[std::min(l, geometry.lods.size() - 1)].error);
+			}
+			lods.push_back(lod);
+		}
+		boundsMin = resource->boundsMin;
+		boundsMax = resource->boundsMax;
+		boundsCenter = resource->boundsCenter;
+		boundsRadius = resource->boundsRadius;
+		collision = resource->collision;
+		hull = resource->hull;
 	}
 	Model3D::~Model3D() {
-        for (size_t i = 0; i < loadedTextures.size(); i++) {
-            glDeleteTextures(1, &loadedTextures.at(i).id);
+        if (instanceVBO != 0) {
+            gps::GeometryArena::ForgetInstanceBuffer(instanceVBO);
+            glDeleteBuffers(1, &instanceVBO);
         }
-        for (size_t i = 0; i < meshes.size(); i++) {
-            GLuint VBO = meshes.at(i).getBuffers().VBO;
-            GLuint EBO = meshes.at(i).getBuffers().EBO;
-            GLuint VAO = meshes.at(i).getBuffers().VAO;
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
+        for (size_t l = 0; l < lods.size(); l++) {
+            if (lods[l].instanceVBO != 0) {
+                gps::GeometryArena::ForgetInstanceBuffer(lods[l].instanceVBO);
+                glDeleteBuffers(1, &lods[l].instanceVBO);
+            }
         }
 	}
 }
\ No newline at end of file
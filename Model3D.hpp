@@ -1,24 +1,80 @@
 #ifndef Model3D_hpp
 #define Model3D_hpp
 #include "Mesh.hpp"
+#include "AssetLoader.hpp"
+#include "AssetRegistry.hpp"
+#include "TextureStreamer.hpp"
+#include "MappedFile.hpp"
+#include "TriangleBvh.hpp"
+#include "ConvexHull.hpp"
 #include "tiny_obj_loader.h"
 #include "stb_image.h"
 #include <iostream>
 #include <string>
 #include <vector>
+#include <memory>
 namespace gps {
+    struct StagedTexture {
+        std::string path;
+        std::shared_ptr<gps::MipChain> mips;
+        std::shared_ptr<gps::TextureResource> resource;
+    };
+    struct StagedModel {
+        std::vector<gps::MeshData> meshes;
+        std::vector<gps::StagedTexture> textures;
+        std::shared_ptr<gps::MappedFile> cookedFile;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 boundsCenter;
+        float boundsRadius;
+        std::shared_ptr<gps::TriangleBvh> collision;
+        std::shared_ptr<gps::ConvexHull> hull;
+        std::string log;
+    };
+    struct ModelLod {
+        std::vector<gps::Mesh> meshes;
+        GLuint instanceVBO;
+        float error;
+    };
     class Model3D {
     public:
+        static const int MAX_LODS = 5;
         std::vector<gps::Mesh> meshes;
-        std::vector<gps::Texture> loadedTextures;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        glm::vec3 boundsCenter = glm::vec3(0.0f);
+        float boundsRadius = 0.0f;
         ~Model3D();
 		void LoadModel(std::string fileName);
 		void LoadModel(std::string fileName, std::string basePath);
-		void Draw(gps::Shader shaderProgram);
+		void LoadModel(std::string fileName, gps::AssetLoader& loader);
+		void Draw(gps::Shader& shaderProgram);
+		void DrawInstanced(gps::Shader& shaderProgram, const std::vector<gps::InstanceData>& instances);
+		void UploadInstances(const std::vector<gps::InstanceData>& instances);
+		void UploadInstances(const std::vector<gps::InstanceData>& instances, int lod);
+		int LodCount() const;
+		float LodError(int lod) const;
+		std::vector<gps::Mesh>& LodMeshes(int lod);
+		const gps::TriangleBvh* CollisionMesh() const;
+		const gps::ConvexHull* CollisionHull() const;
     private:
-		void ReadOBJ(std::string fileName, std::string basePath);
-		gps::Texture LoadTexture(std::string path, std::string type);
-		GLuint ReadTextureFromFile(const char* file_name);
+		GLuint instanceVBO = 0;
+		std::vector<gps::ModelLod> lods;
+		std::shared_ptr<gps::ModelResource> resource;
+		std::shared_ptr<gps::TriangleBvh> collision;
+		std::shared_ptr<gps::ConvexHull> hull;
+		void Load(std::string fileName, std::string basePath, gps::AssetLoader& loader);
+		static void StageModel(std::string fileName, std::string basePath, gps::StagedModel& staged);
+		static void StageOBJ(std::string fileName, std::string basePath, gps::StagedModel& staged);
+		static bool StageCooked(std::string fileName, gps::StagedModel& staged);
+		static void StageTextures(gps::StagedModel& staged);
+		static void WriteCooked(std::string fileName, const gps::StagedModel& staged);
+		static void ComputeBounds(gps::StagedModel& staged);
+		static void BuildLods(gps::StagedModel& staged);
+		static void BuildCollision(gps::StagedModel& staged);
+		static void QuantizeMeshes(gps::StagedModel& staged);
+		void UploadStaged(gps::StagedModel& staged);
+		void Instantiate();
     };
 }
 #endif  
\ No newline at end of file
@@ -19,12 +19,12 @@ namespace gps {
         shader.loadShader("shaders/particle.vert", "shaders/particle.frag");
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
+        GLState::BindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-        glBindVertexArray(0);
+        GLState::BindVertexArray(0);
     }
     void ParticleSystem::Update(float delta, glm::vec3 centerPos) {
         glm::vec3 wind = glm::vec3(5.0f, 0.0f, 2.0f); 
@@ -50,13 +50,10 @@ namespace gps {
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_DYNAMIC_DRAW);
     }
-    void ParticleSystem::Draw(glm::mat4 view, glm::mat4 projection) {
+    void ParticleSystem::Draw() {
         shader.useShaderProgram();
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-        glBindVertexArray(VAO);
+        shader.setMat4(gps::Shader::UNIFORM_MODEL, glm::mat4(1.0f));
+        GLState::BindVertexArray(VAO);
         glDrawArrays(GL_LINES, 0, particleCount * 2);
-        glBindVertexArray(0);
     }
 }
\ No newline at end of file
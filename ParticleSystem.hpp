@@ -13,7 +13,7 @@ namespace gps {
         ParticleSystem();
         void Init(int count, glm::vec3 spawnCenter, glm::vec3 spawnRange);
         void Update(float delta, glm::vec3 centerPos);
-        void Draw(glm::mat4 view, glm::mat4 projection);
+        void Draw();
     private:
         std::vector<Particle> particles;
         int particleCount;
@@ -0,0 +1,211 @@
+#include "RenderQueue.hpp"
+#include "GeometryArena.hpp"
+#include <iostream>
+namespace gps {
+    const int PASS_BITS = 4;
+    const int SHADER_BITS = 8;
+    const int TEXTURE_BITS = 16;
+    const int MESH_BITS = 16;
+    const int DEPTH_BITS = 20;
+    const int DEPTH_SHIFT = 0;
+    const int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    const int TEXTURE_SHIFT = MESH_SHIFT + MESH_BITS;
+    const int SHADER_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+    const int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+    bool RenderQueue::multiDrawIndirect = false;
+    DrawStats RenderQueue::stats = {0, 0};
+    unsigned long long RenderQueue::MakeKey(Pass pass, GLuint shader, GLuint texture, GLuint mesh, float depth, float depthRange) {
+        float normalizedDepth = depth / depthRange;
+        if (normalizedDepth < 0.0f) normalizedDepth = 0.0f;
+        if (normalizedDepth > 1.0f) normalizedDepth = 1.0f;
+        unsigned long long depthBits = (unsigned long long)(normalizedDepth * ((1 << DEPTH_BITS) - 1));
+        unsigned long long key = 0;
+        key |= ((unsigned long long)pass & ((1ull << PASS_BITS) - 1)) << PASS_SHIFT;
+        key |= ((unsigned long long)shader & ((1ull << SHADER_BITS) - 1)) << SHADER_SHIFT;
+        key |= ((unsigned long long)texture & ((1ull << TEXTURE_BITS) - 1)) << TEXTURE_SHIFT;
+        key |= ((unsigned long long)mesh & ((1ull << MESH_BITS) - 1)) << MESH_SHIFT;
+        key |= depthBits << DEPTH_SHIFT;
+        return key;
+    }
+    void RenderQueue::DetectMultiDrawIndirect() {
+        multiDrawIndirect = false;
+#if not defined (__APPLE__)
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        multiDrawIndirect = (major > 4 || (major == 4 && minor >= 3));
+#endif
+        std::cout << "Draw submission: " << (multiDrawIndirect ? "multi-draw indirect" : "instanced draws") << std::endl;
+    }
+    bool RenderQueue::MultiDrawIndirect() {
+        return multiDrawIndirect;
+    }
+    DrawStats RenderQueue::GetStats() {
+        return stats;
+    }
+    void RenderQueue::ResetStats() {
+        stats.packets = 0;
+        stats.drawCalls = 0;
+    }
+    RenderQueue::RenderQueue() {
+        instanceBuffer = 0;
+        indirectBuffer = 0;
+        instanceCapacity = 0;
+        indirectCapacity = 0;
+    }
+    RenderQueue::~RenderQueue() {
+        if (instanceBuffer != 0) {
+            GeometryArena::ForgetInstanceBuffer(instanceBuffer);
+            glDeleteBuffers(1, &instanceBuffer);
+        }
+        if (indirectBuffer != 0) {
+            glDeleteBuffers(1, &indirectBuffer);
+        }
+    }
+    void RenderQueue::Clear() {
+        packets.clear();
+        instances.clear();
+    }
+    void RenderQueue::Push(unsigned long long key, gps::Shader* shader, gps::Mesh* mesh, GLsizei instanceCount, GLuint baseInstance) {
+        DrawPacket packet;
+        packet.key = key;
+        packet.shader = shader;
+        packet.mesh = mesh;
+        packet.instanceCount = instanceCount;
+        packet.baseInstance = baseInstance;
+        packets.push_back(packet);
+    }
+    GLuint RenderQueue::AddInstances(const std::vector<gps::InstanceData>& data) {
+        GLuint baseInstance = (GLuint)instances.size();
+        instances.insert(instances.end(), data.begin(), data.end());
+        return baseInstance;
+    }
+    void RenderQueue::Sort() {
+        scratch.resize(packets.size());
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t counts[257] = {0};
+            for (size_t i = 0; i < packets.size(); i++) {
+                counts[((packets[i].key >> shift) & 0xFF) + 1]++;
+            }
+            bool singleBucket = false;
+            for (int b = 1; b <= 256; b++) {
+                if (counts[b] == packets.size()) {
+                    singleBucket = true;
+                    break;
+                }
+            }
+            if (singleBucket) {
+                continue;
+            }
+            for (int b = 1; b <= 256; b++) {
+                counts[b] += counts[b - 1];
+            }
+            for (size_t i = 0; i < packets.size(); i++) {
+                scratch[counts[(packets[i].key >> shift) & 0xFF]++] = packets[i];
+            }
+            packets.swap(scratch);
+        }
+    }
+    void RenderQueue::Execute() {
+        stats.packets += packets.size();
+        if (multiDrawIndirect) {
+            ExecuteIndirect();
+        } else {
+            ExecuteInstanced();
+        }
+    }
+    void RenderQueue::ExecuteInstanced() {
+        gps::Shader* currentShader = NULL;
+        for (size_t i = 0; i < packets.size(); i++) {
+            DrawPacket& packet = packets[i];
+            if (packet.shader != currentShader) {
+                if (currentShader != NULL) {
+                    currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+                }
+                currentShader = packet.shader;
+                currentShader->useShaderProgram();
+                currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 1);
+            }
+            packet.mesh->DrawInstanced(*packet.shader, packet.instanceCount);
+            stats.drawCalls++;
+        }
+        if (currentShader != NULL) {
+            currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+        }
+    }
+    void RenderQueue::ExecuteIndirect() {
+#if not defined (__APPLE__)
+        if (packets.empty()) {
+            return;
+        }
+        buckets.clear();
+        packetBuckets.resize(packets.size());
+        for (size_t i = 0; i < packets.size(); i++) {
+            DrawPacket& packet = packets[i];
+            size_t bucket = buckets.size();
+            for (size_t b = 0; b < buckets.size(); b++) {
+                if (buckets[b].shader == packet.shader && buckets[b].mesh->SharesMaterial(*packet.mesh)) {
+                    bucket = b;
+                    break;
+                }
+            }
+            if (bucket == buckets.size()) {
+                IndirectBucket created = { packet.shader, packet.mesh, 0, 0 };
+                buckets.push_back(created);
+            }
+            buckets[bucket].count++;
+            packetBuckets[i] = bucket;
+        }
+        size_t first = 0;
+        for (size_t b = 0; b < buckets.size(); b++) {
+            buckets[b].first = first;
+            first += buckets[b].count;
+            buckets[b].count = 0;
+        }
+        commands.resize(packets.size());
+        for (size_t i = 0; i < packets.size(); i++) {
+            IndirectBucket& bucket = buckets[packetBuckets[i]];
+            commands[bucket.first + bucket.count++] = packets[i].mesh->IndirectCommand((GLuint)packets[i].instanceCount, packets[i].baseInstance);
+        }
+        if (instanceBuffer == 0) {
+            glGenBuffers(1, &instanceBuffer);
+            glGenBuffers(1, &indirectBuffer);
+        }
+        StreamBuffer(GL_ARRAY_BUFFER, instanceBuffer, instanceCapacity, instances.data(), instances.size() * sizeof(gps::InstanceData));
+        StreamBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer, indirectCapacity, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        gps::Shader* currentShader = NULL;
+        for (size_t b = 0; b < buckets.size(); b++) {
+            IndirectBucket& bucket = buckets[b];
+            if (bucket.shader != currentShader) {
+                if (currentShader != NULL) {
+                    currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+                }
+                currentShader = bucket.shader;
+                currentShader->useShaderProgram();
+                currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 1);
+            }
+            bucket.mesh->BindIndirect(*bucket.shader, instanceBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)(bucket.first * sizeof(DrawElementsIndirectCommand)), (GLsizei)bucket.count, 0);
+            stats.drawCalls++;
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        if (currentShader != NULL) {
+            currentShader->setInt(gps::Shader::UNIFORM_IS_INSTANCED, 0);
+        }
+#endif
+    }
+    void RenderQueue::StreamBuffer(GLenum target, GLuint buffer, size_t& capacity, const void* data, size_t bytes) {
+        glBindBuffer(target, buffer);
+        if (bytes > capacity) {
+            capacity = bytes * 2;
+        }
+        glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, bytes, data);
+        glBindBuffer(target, 0);
+    }
+    size_t RenderQueue::Size() const {
+        return packets.size();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef RenderQueue_hpp
+#define RenderQueue_hpp
+#include <vector>
+#include "Mesh.hpp"
+#include "Shader.hpp"
+namespace gps {
+    struct DrawPacket {
+        unsigned long long key;
+        gps::Shader* shader;
+        gps::Mesh* mesh;
+        GLsizei instanceCount;
+        GLuint baseInstance;
+    };
+    struct DrawStats {
+        size_t packets;
+        size_t drawCalls;
+    };
+    class RenderQueue {
+    public:
+        enum Pass {
+            PASS_SHADOW,
+            PASS_OPAQUE
+        };
+        static unsigned long long MakeKey(Pass pass, GLuint shader, GLuint texture, GLuint mesh, float depth, float depthRange);
+        static void DetectMultiDrawIndirect();
+        static bool MultiDrawIndirect();
+        static DrawStats GetStats();
+        static void ResetStats();
+        RenderQueue();
+        ~RenderQueue();
+        void Clear();
+        void Push(unsigned long long key, gps::Shader* shader, gps::Mesh* mesh, GLsizei instanceCount, GLuint baseInstance = 0);
+        GLuint AddInstances(const std::vector<gps::InstanceData>& data);
+        void Sort();
+        void Execute();
+        size_t Size() const;
+    private:
+        struct IndirectBucket {
+            gps::Shader* shader;
+            gps::Mesh* mesh;
+            size_t first;
+            size_t count;
+        };
+        static bool multiDrawIndirect;
+        static DrawStats stats;
+        std::vector<DrawPacket> packets;
+        std::vector<DrawPacket> scratch;
+        std::vector<gps::InstanceData> instances;
+        std::vector<IndirectBucket> buckets;
+        std::vector<size_t> packetBuckets;
+        std::vector<DrawElementsIndirectCommand> commands;
+        GLuint instanceBuffer;
+        GLuint indirectBuffer;
+        size_t instanceCapacity;
+        size_t indirectCapacity;
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue& operator=(const RenderQueue&) = delete;
+        void ExecuteInstanced();
+        void ExecuteIndirect();
+        static void StreamBuffer(GLenum target, GLuint buffer, size_t& capacity, const void* data, size_t bytes);
+    };
+}
+#endif
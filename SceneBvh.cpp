@@ -0,0 +1,94 @@
+#include "SceneBvh.hpp"
+#include <algorithm>
+#include <cfloat>
+namespace gps {
+    void SceneBvh::Clear() {
+        instances.clear();
+        nodes.clear();
+        order.clear();
+    }
+    void SceneBvh::AddInstance(const gps::TriangleBvh* mesh, const glm::mat4& modelMatrix, int owner) {
+        if (mesh == NULL || mesh->TriangleCount() == 0) {
+            return;
+        }
+        Instance instance;
+        instance.mesh = mesh;
+        instance.modelMatrix = modelMatrix;
+        instance.inverseMatrix = glm::inverse(modelMatrix);
+        instance.owner = owner;
+        glm::vec3 localMin = mesh->BoundsMin();
+        glm::vec3 localMax = mesh->BoundsMax();
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 local = glm::vec3((corner & 1) ? localMax.x : localMin.x, (corner & 2) ? localMax.y : localMin.y, (corner & 4) ? localMax.z : localMin.z);
+            glm::vec3 world = glm::vec3(modelMatrix * glm::vec4(local, 1.0f));
+            instance.boundsMin = corner == 0 ? world : glm::min(instance.boundsMin, world);
+            instance.boundsMax = corner == 0 ? world : glm::max(instance.boundsMax, world);
+        }
+        instances.push_back(instance);
+    }
+    void SceneBvh::Build() {
+        std::vector<glm::vec3> instanceMin(instances.size());
+        std::vector<glm::vec3> instanceMax(instances.size());
+        for (size_t i = 0; i < instances.size(); i++) {
+            instanceMin[i] = instances[i].boundsMin;
+            instanceMax[i] = instances[i].boundsMax;
+        }
+        Bvh::Build(instanceMin, instanceMax, nodes, order);
+    }
+    void SceneBvh::RayCast(const std::vector<gps::Ray>& rays, std::vector<gps::RayHit>& hits) const {
+        hits.resize(rays.size());
+        for (size_t i = 0; i < rays.size(); i++) {
+            hits[i] = RayCast(rays[i]);
+        }
+    }
+    gps::RayHit SceneBvh::RayCast(const gps::Ray& ray) const {
+        RayHit result;
+        result.hit = false;
+        result.distance = ray.maxDistance;
+        result.point = ray.origin + ray.direction * ray.maxDistance;
+        result.normal = glm::vec3(0.0f);
+        result.owner = -1;
+        result.triangle = -1;
+        if (nodes.empty()) {
+            return result;
+        }
+        BvhRay bvhRay = Bvh::PrepareRay(ray.origin, ray.direction);
+        const Instance* hitInstance = NULL;
+        unsigned int stack[Bvh::STACK_SIZE];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            const BvhNode& node = nodes[stack[--stackSize]];
+            if (Bvh::IntersectBox(bvhRay, node, result.distance) == FLT_MAX) {
+                continue;
+            }
+            if (node.count == 0) {
+                stack[stackSize++] = node.leftFirst + 1;
+                stack[stackSize++] = node.leftFirst;
+                continue;
+            }
+            for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                const Instance& instance = instances[order[i]];
+                glm::vec3 localOrigin = glm::vec3(instance.inverseMatrix * glm::vec4(ray.origin, 1.0f));
+                glm::vec3 localDirection = glm::vec3(instance.inverseMatrix * glm::vec4(ray.direction, 0.0f));
+                if (instance.mesh->Intersect(localOrigin, localDirection, result.distance, result.triangle)) {
+                    hitInstance = &instance;
+                }
+            }
+        }
+        if (hitInstance != NULL) {
+            result.hit = true;
+            result.point = ray.origin + ray.direction * result.distance;
+            glm::vec3 localNormal = hitInstance->mesh->Normal(result.triangle);
+            result.normal = glm::normalize(glm::vec3(glm::transpose(hitInstance->inverseMatrix) * glm::vec4(localNormal, 0.0f)));
+            if (glm::dot(result.normal, ray.direction) > 0.0f) {
+                result.normal = -result.normal;
+            }
+            result.owner = hitInstance->owner;
+        }
+        return result;
+    }
+    size_t SceneBvh::InstanceCount() const {
+        return instances.size();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef SceneBvh_hpp
+#define SceneBvh_hpp
+#include <glm/glm.hpp>
+#include <vector>
+#include "Bvh.hpp"
+#include "TriangleBvh.hpp"
+namespace gps {
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        float maxDistance;
+    };
+    struct RayHit {
+        bool hit;
+        float distance;
+        glm::vec3 point;
+        glm::vec3 normal;
+        int owner;
+        int triangle;
+    };
+    class SceneBvh {
+    public:
+        void Clear();
+        void AddInstance(const gps::TriangleBvh* mesh, const glm::mat4& modelMatrix, int owner);
+        void Build();
+        void RayCast(const std::vector<gps::Ray>& rays, std::vector<gps::RayHit>& hits) const;
+        gps::RayHit RayCast(const gps::Ray& ray) const;
+        size_t InstanceCount() const;
+    private:
+        struct Instance {
+            const gps::TriangleBvh* mesh;
+            glm::mat4 modelMatrix;
+            glm::mat4 inverseMatrix;
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+            int owner;
+        };
+        std::vector<Instance> instances;
+        std::vector<gps::BvhNode> nodes;
+        std::vector<unsigned int> order;
+    };
+}
+#endif
@@ -1,4 +1,5 @@
 #include "Shader.hpp"
+#include <glm/gtc/type_ptr.hpp>
 namespace gps {
     std::string Shader::readShaderFile(std::string fileName) {
         std::ifstream shaderFile;
@@ -50,8 +51,164 @@ namespace gps {
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
         shaderLinkLog(this->shaderProgram);
+        reflectUniforms();
+        bindUniformBlocks();
+    }
+    void Shader::loadComputeShader(std::string computeShaderFileName) {
+#if not defined (__APPLE__)
+        std::string c = readShaderFile(computeShaderFileName);
+        const GLchar* computeShaderString = c.c_str();
+        GLuint computeShader;
+        computeShader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(computeShader, 1, &computeShaderString, NULL);
+        glCompileShader(computeShader);
+        shaderCompileLog(computeShader);
+        this->shaderProgram = glCreateProgram();
+        glAttachShader(this->shaderProgram, computeShader);
+        glLinkProgram(this->shaderProgram);
+        glDeleteShader(computeShader);
+        shaderLinkLog(this->shaderProgram);
+        reflectUniforms();
+#endif
+    }
+    void Shader::bindUniformBlocks() {
+        const char* blockNames[BLOCK_COUNT] = { "FrameData", "LightData", "ShadowData" };
+        for (int i = 0; i < BLOCK_COUNT; i++) {
+            GLuint blockIndex = glGetUniformBlockIndex(this->shaderProgram, blockNames[i]);
+            if (blockIndex != GL_INVALID_INDEX) {
+                glUniformBlockBinding(this->shaderProgram, blockIndex, (GLuint)i);
+            }
+        }
     }
     void Shader::useShaderProgram() {
-        glUseProgram(this->shaderProgram);
+        GLState::UseProgram(this->shaderProgram);
+    }
+    std::vector<std::string>& Shader::uniformNames() {
+        static std::vector<std::string> names = {
+            "model",
+            "view",
+            "projection",
+            "normalMatrix",
+            "Ka",
+            "Kd",
+            "Ks",
+            "hasTexture",
+            "isInstanced",
+            "ambientTexture",
+            "diffuseTexture",
+            "specularTexture",
+            "shadowMap",
+            "skybox",
+            "positionOffset",
+            "positionScale"
+        };
+        return names;
+    }
+    std::unordered_map<std::string, int>& Shader::uniformIds() {
+        static std::unordered_map<std::string, int> ids;
+        if (ids.empty()) {
+            std::vector<std::string>& names = uniformNames();
+            for (size_t i = 0; i < names.size(); i++) {
+                ids[names[i]] = (int)i;
+            }
+        }
+        return ids;
+    }
+    int Shader::internUniform(const std::string& name) {
+        std::unordered_map<std::string, int>& ids = uniformIds();
+        std::unordered_map<std::string, int>::iterator it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        int id = (int)uniformNames().size();
+        uniformNames().push_back(name);
+        ids[name] = id;
+        return id;
+    }
+    void Shader::reflectUniforms() {
+        activeUniforms.clear();
+        uniformLocations.clear();
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++) {
+            GLint size = 0;
+            GLenum type = 0;
+            GLsizei length = 0;
+            glGetActiveUniform(this->shaderProgram, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            GLint location = glGetUniformLocation(this->shaderProgram, name.c_str());
+            if (location < 0) {
+                continue;
+            }
+            activeUniforms[name] = location;
+            size_t bracket = name.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == name.size()) {
+                std::string baseName = name.substr(0, bracket);
+                activeUniforms[baseName] = location;
+                for (GLint element = 1; element < size; element++) {
+                    std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                    activeUniforms[elementName] = glGetUniformLocation(this->shaderProgram, elementName.c_str());
+                }
+            }
+        }
+        resolveUniformLocations();
+    }
+    void Shader::resolveUniformLocations() {
+        std::vector<std::string>& names = uniformNames();
+        for (size_t i = uniformLocations.size(); i < names.size(); i++) {
+            std::unordered_map<std::string, GLint>::iterator it = activeUniforms.find(names[i]);
+            uniformLocations.push_back(it != activeUniforms.end() ? it->second : -1);
+        }
+    }
+    GLint Shader::getUniformLocation(int uniform) {
+        if (uniform >= (int)uniformLocations.size()) {
+            resolveUniformLocations();
+        }
+        return uniformLocations[uniform];
+    }
+    GLint Shader::getUniformLocation(const std::string& name) {
+        return getUniformLocation(internUniform(name));
+    }
+    void Shader::setInt(int uniform, GLint value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniform1i(location, value);
+        }
+    }
+    void Shader::setSampler(int uniform, GLint unit) {
+        GLState::SetSampler(this->shaderProgram, getUniformLocation(uniform), unit);
+    }
+    void Shader::setFloat(int uniform, GLfloat value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniform1f(location, value);
+        }
+    }
+    void Shader::setVec3(int uniform, const glm::vec3& value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniform3fv(location, 1, glm::value_ptr(value));
+        }
+    }
+    void Shader::setVec4(int uniform, const glm::vec4& value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniform4fv(location, 1, glm::value_ptr(value));
+        }
+    }
+    void Shader::setMat3(int uniform, const glm::mat3& value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+    }
+    void Shader::setMat4(int uniform, const glm::mat4& value) {
+        GLint location = getUniformLocation(uniform);
+        if (location >= 0) {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
     }
 }
\ No newline at end of file
@@ -7,19 +7,67 @@
     #define GLEW_STATIC
     #include <GL/glew.h>
 #endif
+#include <glm/glm.hpp>
+#include "GLState.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
 namespace gps {
     class Shader {
     public:
+        enum Uniform {
+            UNIFORM_MODEL,
+            UNIFORM_VIEW,
+            UNIFORM_PROJECTION,
+            UNIFORM_NORMAL_MATRIX,
+            UNIFORM_KA,
+            UNIFORM_KD,
+            UNIFORM_KS,
+            UNIFORM_HAS_TEXTURE,
+            UNIFORM_IS_INSTANCED,
+            UNIFORM_AMBIENT_TEXTURE,
+            UNIFORM_DIFFUSE_TEXTURE,
+            UNIFORM_SPECULAR_TEXTURE,
+            UNIFORM_SHADOW_MAP,
+            UNIFORM_SKYBOX,
+            UNIFORM_POSITION_OFFSET,
+            UNIFORM_POSITION_SCALE,
+            UNIFORM_COUNT
+        };
+        enum UniformBlock {
+            BLOCK_FRAME_DATA,
+            BLOCK_LIGHT_DATA,
+            BLOCK_SHADOW_DATA,
+            BLOCK_COUNT
+        };
         GLuint shaderProgram;
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
+        void loadComputeShader(std::string computeShaderFileName);
         void useShaderProgram();
+        static int internUniform(const std::string& name);
+        GLint getUniformLocation(int uniform);
+        GLint getUniformLocation(const std::string& name);
+        void setInt(int uniform, GLint value);
+        void setSampler(int uniform, GLint unit);
+        void setFloat(int uniform, GLfloat value);
+        void setVec3(int uniform, const glm::vec3& value);
+        void setVec4(int uniform, const glm::vec4& value);
+        void setMat3(int uniform, const glm::mat3& value);
+        void setMat4(int uniform, const glm::mat4& value);
     private:
+        std::unordered_map<std::string, GLint> activeUniforms;
+        std::vector<GLint> uniformLocations;
         std::string readShaderFile(std::string fileName);
         void shaderCompileLog(GLuint shaderId);
         void shaderLinkLog(GLuint shaderProgramId);
+        void reflectUniforms();
+        void bindUniformBlocks();
+        void resolveUniformLocations();
+        static std::vector<std::string>& uniformNames();
+        static std::unordered_map<std::string, int>& uniformIds();
     };
 }
-#endif  
\ No newline at end of file
+#endif  
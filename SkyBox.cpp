@@ -1,24 +1,23 @@
 #include "SkyBox.hpp"
-#include "stb_image.h"
+#include "TextureCache.hpp"
+#include <memory>
 namespace gps {
     SkyBox::SkyBox() {
     }
-    void SkyBox::Load(std::vector<std::string> cubeMapFaces) {
+    void SkyBox::Load(std::vector<std::string> cubeMapFaces, gps::AssetLoader& loader) {
         InitSkyBox();
-        textureID = LoadSkyBoxTextures(cubeMapFaces);
+        LoadSkyBoxTextures(cubeMapFaces, loader);
     }
-    void SkyBox::Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix) {
+    void SkyBox::Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix) {
         shader.useShaderProgram();
         viewMatrix = glm::mat4(glm::mat3(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(viewMatrix));
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        shader.setMat4(gps::Shader::UNIFORM_VIEW, viewMatrix);
+        shader.setMat4(gps::Shader::UNIFORM_PROJECTION, projectionMatrix);
         glDepthFunc(GL_LEQUAL);
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glUniform1i(glGetUniformLocation(shader.shaderProgram, "skybox"), 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        GLState::BindVertexArray(skyboxVAO);
+        shader.setSampler(gps::Shader::UNIFORM_SKYBOX, 0);
+        GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
         glDepthFunc(GL_LESS);
     }
     void SkyBox::InitSkyBox() {
@@ -62,38 +61,52 @@ namespace gps {
         };
         glGenVertexArrays(1, &skyboxVAO);
         glGenBuffers(1, &skyboxVBO);
-        glBindVertexArray(skyboxVAO);
+        GLState::BindVertexArray(skyboxVAO);
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     }
-    GLuint SkyBox::LoadSkyBoxTextures(std::vector<std::string> cubeMapFaces) {
-        GLuint textureID;
+    void SkyBox::LoadSkyBoxTextures(std::vector<std::string> cubeMapFaces, gps::AssetLoader& loader) {
         glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-        int width, height, nrChannels;
-        for (unsigned int i = 0; i < cubeMapFaces.size(); i++)
-        {
-            unsigned char *data = stbi_load(cubeMapFaces[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                             0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-                );
-                stbi_image_free(data);
-            }
-            else
-            {
-                std::cout << "Cubemap texture failed to load at path: " << cubeMapFaces[i] << std::endl;
-                stbi_image_free(data);
-            }
-        }
+        GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        return textureID;
+        gps::AssetLoader* uploadQueue = &loader;
+        for (unsigned int i = 0; i < cubeMapFaces.size(); i++)
+        {
+            std::string face = cubeMapFaces[i];
+            loader.Submit([this, face, i, uploadQueue]() {
+                std::shared_ptr<gps::MipChain> mips = std::make_shared<gps::MipChain>();
+                if (!gps::TextureCache::Load(face, false, *mips))
+                {
+                    if (!gps::AssetLoader::DecodeImage(face, 3, false, mips->image))
+                    {
+                        std::cout << "Cubemap texture failed to load at path: " << face << std::endl;
+                        return;
+                    }
+                    gps::TextureStreamer::SingleLevel(*mips);
+                    gps::TextureCache::Cook(face, false, *mips);
+                }
+                uploadQueue->QueueUpload([this, mips, i]() {
+                    const gps::MipLevel& level = mips->levels[0];
+                    GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
+                    if (mips->compressedFormat != 0) {
+                        glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                                               0, mips->compressedFormat, level.width, level.height, 0, (GLsizei)level.size, level.data
+                        );
+                    } else {
+                        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
+                                     0, GL_RGB, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, level.data
+                        );
+                        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                    }
+                });
+            });
+        }
     }
 }
\ No newline at end of file
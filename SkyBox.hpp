@@ -13,17 +13,18 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Shader.hpp"
+#include "AssetLoader.hpp"
 namespace gps {
     class SkyBox {
     public:
         SkyBox();
-        void Load(std::vector<std::string> cubeMapFaces);
-        void Draw(gps::Shader shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+        void Load(std::vector<std::string> cubeMapFaces, gps::AssetLoader& loader);
+        void Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
     private:
         GLuint skyboxVAO, skyboxVBO;
         GLuint textureID;
         void InitSkyBox();
-        GLuint LoadSkyBoxTextures(std::vector<std::string> cubeMapFaces);
+        void LoadSkyBoxTextures(std::vector<std::string> cubeMapFaces, gps::AssetLoader& loader);
     };
 }
 #endif  
\ No newline at end of file
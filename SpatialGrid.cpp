@@ -0,0 +1,87 @@
+#include "SpatialGrid.hpp"
+#include <algorithm>
+#include <cmath>
+namespace gps {
+    SpatialGrid::SpatialGrid(float cellSize) {
+        this->cellSize = cellSize;
+        queryStamp = 0;
+    }
+    void SpatialGrid::Clear() {
+        cells.clear();
+        stamps.clear();
+        queryStamp = 0;
+    }
+    int SpatialGrid::CellCoordinate(float value) const {
+        return (int)std::floor(value / cellSize);
+    }
+    unsigned long long SpatialGrid::Key(int x, int z) {
+        return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)z;
+    }
+    void SpatialGrid::Insert(int id, glm::vec2 boundsMin, glm::vec2 boundsMax) {
+        if ((size_t)id >= stamps.size()) {
+            stamps.resize(id + 1, 0);
+        }
+        int x0 = CellCoordinate(boundsMin.x);
+        int z0 = CellCoordinate(boundsMin.y);
+        int x1 = CellCoordinate(boundsMax.x);
+        int z1 = CellCoordinate(boundsMax.y);
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                cells[Key(x, z)].push_back(id);
+            }
+        }
+    }
+    void SpatialGrid::Remove(int id, glm::vec2 boundsMin, glm::vec2 boundsMax) {
+        int x0 = CellCoordinate(boundsMin.x);
+        int z0 = CellCoordinate(boundsMin.y);
+        int x1 = CellCoordinate(boundsMax.x);
+        int z1 = CellCoordinate(boundsMax.y);
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                std::unordered_map<unsigned long long, std::vector<int> >::iterator cell = cells.find(Key(x, z));
+                if (cell == cells.end()) {
+                    continue;
+                }
+                std::vector<int>& ids = cell->second;
+                std::vector<int>::iterator it = std::find(ids.begin(), ids.end(), id);
+                if (it != ids.end()) {
+                    *it = ids.back();
+                    ids.pop_back();
+                }
+                if (ids.empty()) {
+                    cells.erase(cell);
+                }
+            }
+        }
+    }
+    void SpatialGrid::Query(glm::vec2 boundsMin, glm::vec2 boundsMax, std::vector<int>& results) {
+        results.clear();
+        queryStamp++;
+        if (queryStamp == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            queryStamp = 1;
+        }
+        int x0 = CellCoordinate(boundsMin.x);
+        int z0 = CellCoordinate(boundsMin.y);
+        int x1 = CellCoordinate(boundsMax.x);
+        int z1 = CellCoordinate(boundsMax.y);
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                std::unordered_map<unsigned long long, std::vector<int> >::const_iterator cell = cells.find(Key(x, z));
+                if (cell == cells.end()) {
+                    continue;
+                }
+                const std::vector<int>& ids = cell->second;
+                for (size_t i = 0; i < ids.size(); i++) {
+                    if (stamps[ids[i]] != queryStamp) {
+                        stamps[ids[i]] = queryStamp;
+                        results.push_back(ids[i]);
+                    }
+                }
+            }
+        }
+    }
+    size_t SpatialGrid::CellCount() const {
+        return cells.size();
+    }
+}
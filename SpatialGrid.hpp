@@ -0,0 +1,24 @@
+#ifndef SpatialGrid_hpp
+#define SpatialGrid_hpp
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+namespace gps {
+    class SpatialGrid {
+    public:
+        explicit SpatialGrid(float cellSize = 64.0f);
+        void Clear();
+        void Insert(int id, glm::vec2 boundsMin, glm::vec2 boundsMax);
+        void Remove(int id, glm::vec2 boundsMin, glm::vec2 boundsMax);
+        void Query(glm::vec2 boundsMin, glm::vec2 boundsMax, std::vector<int>& results);
+        size_t CellCount() const;
+    private:
+        float cellSize;
+        std::unordered_map<unsigned long long, std::vector<int> > cells;
+        std::vector<unsigned int> stamps;
+        unsigned int queryStamp;
+        int CellCoordinate(float value) const;
+        static unsigned long long Key(int x, int z);
+    };
+}
+#endif
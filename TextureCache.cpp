@@ -0,0 +1,383 @@
+#include "TextureCache.hpp"
+#include "MeshCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+namespace gps {
+    bool TextureCache::dxt1Supported = false;
+    bool TextureCache::dxt5Supported = false;
+    static unsigned long long AlignOffset(unsigned long long offset) {
+        return (offset + 15) & ~15ull;
+    }
+    static unsigned short PackColor(const float color[3]) {
+        int r = std::min(31, std::max(0, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+        int g = std::min(63, std::max(0, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+        int b = std::min(31, std::max(0, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+        return (unsigned short)((r << 11) | (g << 5) | b);
+    }
+    static void UnpackColor(unsigned short packed, int color[3]) {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+    void TextureCache::DetectFormats() {
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &formatCount);
+        std::vector<GLint> formats(std::max(formatCount, 0));
+        if (formatCount > 0) {
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        }
+        bool dxt1 = false;
+        bool dxt5 = false;
+        bool srgbDxt1 = false;
+        bool srgbDxt5 = false;
+        for (size_t i = 0; i < formats.size(); i++) {
+            dxt1 = dxt1 || formats[i] == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            dxt5 = dxt5 || formats[i] == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            srgbDxt1 = srgbDxt1 || formats[i] == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+            srgbDxt5 = srgbDxt5 || formats[i] == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        }
+        dxt1Supported = dxt1 && srgbDxt1;
+        dxt5Supported = dxt5 && srgbDxt5;
+        std::cout << "Texture compression : BC1 " << (dxt1Supported ? "yes" : "no") << ", BC3 " << (dxt5Supported ? "yes" : "no") << std::endl;
+    }
+    bool TextureCache::Load(const std::string& sourceFile, bool srgb, gps::MipChain& chain) {
+        std::shared_ptr<gps::MappedFile> file = std::make_shared<gps::MappedFile>();
+        if (!file->Open(gps::MeshCache::CachePath(sourceFile, ".texbin"))) {
+            return false;
+        }
+        if (file->Size() < sizeof(TextureCacheHeader)) {
+            return false;
+        }
+        const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(file->Data());
+        if (header->magic != TEXTURE_CACHE_MAGIC || header->version != TEXTURE_CACHE_VERSION || header->srgb != (srgb ? 1u : 0u)) {
+            return false;
+        }
+        if (header->levelCount == 0 || header->levelCount > (unsigned int)TEXTURE_CACHE_MAX_LEVELS || header->channels == 0 || header->channels > 4) {
+            return false;
+        }
+        if (header->compressedFormat == 0 && header->channels >= 3 && dxt1Supported && (header->translucent == 0 || dxt5Supported)) {
+            return false;
+        }
+        if (header->compressedFormat != 0 && !(header->compressedFormat == (srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT) && dxt1Supported) &&
+            !(header->compressedFormat == (srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) && dxt5Supported)) {
+            return false;
+        }
+        unsigned long long sourceSize = 0;
+        long long sourceModified = 0;
+        if (gps::MeshCache::GetSourceStamp(sourceFile, sourceSize, sourceModified)) {
+            if (sourceSize != header->sourceSize || sourceModified != header->sourceModified) {
+                return false;
+            }
+        }
+        if (file->Size() < sizeof(TextureCacheHeader) + header->levelCount * sizeof(TextureCacheLevel)) {
+            return false;
+        }
+        const TextureCacheLevel* levels = reinterpret_cast<const TextureCacheLevel*>(file->Data() + sizeof(TextureCacheHeader));
+        bool alpha = header->compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT || header->compressedFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        std::vector<gps::MipLevel> mips;
+        for (unsigned int i = 0; i < header->levelCount; i++) {
+            if (levels[i].width <= 0 || levels[i].height <= 0 || levels[i].offset + levels[i].size > file->Size()) {
+                return false;
+            }
+            unsigned long long expected = header->compressedFormat != 0 ?
+                (unsigned long long)((levels[i].width + 3) / 4) * ((levels[i].height + 3) / 4) * (alpha ? 16 : 8) :
+                (unsigned long long)levels[i].width * levels[i].height * header->channels;
+            if (levels[i].size != expected) {
+                return false;
+            }
+            gps::MipLevel mip = { levels[i].width, levels[i].height, file->Data() + levels[i].offset, (size_t)levels[i].size };
+            mips.push_back(mip);
+        }
+        AssetLoader::FreeImage(chain.image);
+        chain.storage.clear();
+        chain.levels = mips;
+        chain.file = file;
+        chain.compressedFormat = header->compressedFormat;
+        chain.channels = (int)header->channels;
+        return true;
+    }
+    bool TextureCache::CachedContentHash(const std::string& sourceFile, unsigned long long& contentHash) {
+        gps::MappedFile file;
+        if (!file.Open(gps::MeshCache::CachePath(sourceFile, ".texbin")) || file.Size() < sizeof(TextureCacheHeader)) {
+            return false;
+        }
+        const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(file.Data());
+        if (header->magic != TEXTURE_CACHE_MAGIC || header->version != TEXTURE_CACHE_VERSION || header->contentHash == 0) {
+            return false;
+        }
+        unsigned long long sourceSize = 0;
+        long long sourceModified = 0;
+        if (!gps::MeshCache::GetSourceStamp(sourceFile, sourceSize, sourceModified) ||
+            sourceSize != header->sourceSize || sourceModified != header->sourceModified) {
+            return false;
+        }
+        contentHash = header->contentHash;
+        return true;
+    }
+    bool TextureCache::Cook(const std::string& sourceFile, bool srgb, gps::MipChain& chain, unsigned long long contentHash) {
+        GLenum format = CompressedFormat(chain, srgb);
+        if (format != 0) {
+            Compress(chain, format);
+        }
+        if (!Write(sourceFile, srgb, chain, contentHash)) {
+            std::cout << "Could not write texture cache for " << sourceFile << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool TextureCache::Translucent(const gps::MipChain& chain) {
+        if (chain.compressedFormat != 0) {
+            return chain.compressedFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT || chain.compressedFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        }
+        if (chain.channels != 4 || chain.levels.empty()) {
+            return false;
+        }
+        const gps::MipLevel& base = chain.levels[0];
+        for (size_t i = 3; i < base.size; i += 4) {
+            if (base.data[i] != 255) {
+                return true;
+            }
+        }
+        return false;
+    }
+    GLenum TextureCache::CompressedFormat(const gps::MipChain& chain, bool srgb) {
+        if (chain.channels < 3 || chain.levels.empty() || !dxt1Supported) {
+            return 0;
+        }
+        if (!Translucent(chain)) {
+            return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        }
+        if (!dxt5Supported) {
+            return 0;
+        }
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    void TextureCache::Compress(gps::MipChain& chain, GLenum format) {
+        bool alpha = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        size_t blockBytes = alpha ? 16 : 8;
+        int channels = chain.channels;
+        std::vector<std::vector<unsigned char> > storage(chain.levels.size());
+        std::vector<gps::MipLevel> levels(chain.levels.size());
+        for (size_t level = 0; level < chain.levels.size(); level++) {
+            const gps::MipLevel& source = chain.levels[level];
+            int blocksWide = (source.width + 3) / 4;
+            int blocksHigh = (source.height + 3) / 4;
+            std::vector<unsigned char>& blocks = storage[level];
+            blocks.resize((size_t)blocksWide * blocksHigh * blockBytes);
+            unsigned char pixels[16][4];
+            for (int by = 0; by < blocksHigh; by++) {
+                for (int bx = 0; bx < blocksWide; bx++) {
+                    for (int p = 0; p < 16; p++) {
+                        int x = std::min(bx * 4 + p % 4, source.width - 1);
+                        int y = std::min(by * 4 + p / 4, source.height - 1);
+                        const unsigned char* pixel = source.data + ((size_t)y * source.width + x) * channels;
+                        pixels[p][0] = pixel[0];
+                        pixels[p][1] = pixel[1];
+                        pixels[p][2] = pixel[2];
+                        pixels[p][3] = channels == 4 ? pixel[3] : 255;
+                    }
+                    unsigned char* out = &blocks[((size_t)by * blocksWide + bx) * blockBytes];
+                    if (alpha) {
+                        EncodeAlphaBlock(pixels, out);
+                        out += 8;
+                    }
+                    EncodeColorBlock(pixels, out);
+                }
+            }
+            gps::MipLevel mip = { source.width, source.height, blocks.data(), blocks.size() };
+            levels[level] = mip;
+        }
+        AssetLoader::FreeImage(chain.image);
+        chain.storage.swap(storage);
+        chain.levels.swap(levels);
+        chain.file.reset();
+        chain.compressedFormat = format;
+    }
+    void TextureCache::EncodeColorBlock(const unsigned char pixels[16][4], unsigned char* out) {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        for (int p = 0; p < 16; p++) {
+            for (int c = 0; c < 3; c++) {
+                mean[c] += pixels[p][c] / 16.0f;
+            }
+        }
+        float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int p = 0; p < 16; p++) {
+            float r = pixels[p][0] - mean[0];
+            float g = pixels[p][1] - mean[1];
+            float b = pixels[p][2] - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            float length = std::max(std::max(fabsf(x), fabsf(y)), fabsf(z));
+            if (length < 1e-6f) {
+                break;
+            }
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+        int minIndex = 0;
+        int maxIndex = 0;
+        float minProjection = 0.0f;
+        float maxProjection = 0.0f;
+        for (int p = 0; p < 16; p++) {
+            float projection = pixels[p][0] * axis[0] + pixels[p][1] * axis[1] + pixels[p][2] * axis[2];
+            if (p == 0 || projection < minProjection) {
+                minProjection = projection;
+                minIndex = p;
+            }
+            if (p == 0 || projection > maxProjection) {
+                maxProjection = projection;
+                maxIndex = p;
+            }
+        }
+        float high[3];
+        float low[3];
+        for (int c = 0; c < 3; c++) {
+            float inset = (pixels[maxIndex][c] - pixels[minIndex][c]) / 16.0f;
+            high[c] = pixels[maxIndex][c] - inset;
+            low[c] = pixels[minIndex][c] + inset;
+        }
+        unsigned short color0 = PackColor(high);
+        unsigned short color1 = PackColor(low);
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+        unsigned int indices = 0;
+        if (color0 != color1) {
+            int palette[4][3];
+            UnpackColor(color0, palette[0]);
+            UnpackColor(color1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int p = 0; p < 16; p++) {
+                int best = 0;
+                int bestDistance = 0;
+                for (int i = 0; i < 4; i++) {
+                    int dr = pixels[p][0] - palette[i][0];
+                    int dg = pixels[p][1] - palette[i][1];
+                    int db = pixels[p][2] - palette[i][2];
+                    int distance = dr * dr + dg * dg + db * db;
+                    if (i == 0 || distance < bestDistance) {
+                        bestDistance = distance;
+                        best = i;
+                    }
+                }
+                indices |= (unsigned int)best << (p * 2);
+            }
+        }
+        out[0] = (unsigned char)(color0 & 0xFF);
+        out[1] = (unsigned char)(color0 >> 8);
+        out[2] = (unsigned char)(color1 & 0xFF);
+        out[3] = (unsigned char)(color1 >> 8);
+        for (int i = 0; i < 4; i++) {
+            out[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+        }
+    }
+    void TextureCache::EncodeAlphaBlock(const unsigned char pixels[16][4], unsigned char* out) {
+        int alpha0 = 0;
+        int alpha1 = 255;
+        for (int p = 0; p < 16; p++) {
+            alpha0 = std::max(alpha0, (int)pixels[p][3]);
+            alpha1 = std::min(alpha1, (int)pixels[p][3]);
+        }
+        unsigned long long indices = 0;
+        if (alpha0 != alpha1) {
+            int palette[8];
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+            }
+            for (int p = 0; p < 16; p++) {
+                int best = 0;
+                int bestDistance = 256;
+                for (int i = 0; i < 8; i++) {
+                    int distance = abs((int)pixels[p][3] - palette[i]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = i;
+                    }
+                }
+                indices |= (unsigned long long)best << (p * 3);
+            }
+        }
+        out[0] = (unsigned char)alpha0;
+        out[1] = (unsigned char)alpha1;
+        for (int i = 0; i < 6; i++) {
+            out[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+        }
+    }
+    bool TextureCache::Write(const std::string& sourceFile, bool srgb, const gps::MipChain& chain, unsigned long long contentHash) {
+        if (chain.levels.empty() || chain.levels.size() > (size_t)TEXTURE_CACHE_MAX_LEVELS) {
+            return false;
+        }
+        TextureCacheHeader header;
+        memset((void*)&header, 0, sizeof(header));
+        header.magic = TEXTURE_CACHE_MAGIC;
+        header.version = TEXTURE_CACHE_VERSION;
+        header.compressedFormat = chain.compressedFormat;
+        header.channels = (unsigned int)chain.channels;
+        header.srgb = srgb ? 1u : 0u;
+        header.levelCount = (unsigned int)chain.levels.size();
+        header.translucent = Translucent(chain) ? 1u : 0u;
+        header.contentHash = contentHash;
+        if (!gps::MeshCache::GetSourceStamp(sourceFile, header.sourceSize, header.sourceModified)) {
+            return false;
+        }
+        gps::MeshCache::EnsureCacheDirectory();
+        std::vector<TextureCacheLevel> levels(chain.levels.size());
+        unsigned long long offset = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureCacheLevel);
+        for (size_t i = 0; i < levels.size(); i++) {
+            offset = AlignOffset(offset);
+            levels[i].width = chain.levels[i].width;
+            levels[i].height = chain.levels[i].height;
+            levels[i].offset = offset;
+            levels[i].size = chain.levels[i].size;
+            offset += levels[i].size;
+        }
+        std::string cachePath = gps::MeshCache::CachePath(sourceFile, ".texbin");
+        std::ostringstream temporaryName;
+        temporaryName << cachePath << ".tmp" << std::this_thread::get_id();
+        std::string temporaryPath = temporaryName.str();
+        std::ofstream out(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        const char zeros[16] = { 0 };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TextureCacheLevel));
+        for (size_t i = 0; i < levels.size(); i++) {
+            out.write(zeros, (std::streamsize)(levels[i].offset - (unsigned long long)out.tellp()));
+            out.write(reinterpret_cast<const char*>(chain.levels[i].data), levels[i].size);
+        }
+        out.close();
+        if (!out) {
+            remove(temporaryPath.c_str());
+            return false;
+        }
+        remove(cachePath.c_str());
+        return rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+    }
+}
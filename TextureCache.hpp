@@ -0,0 +1,64 @@
+#ifndef TextureCache_hpp
+#define TextureCache_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include "TextureStreamer.hpp"
+#include <string>
+#include <vector>
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+    #define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+namespace gps {
+    const unsigned int TEXTURE_CACHE_MAGIC = 0x58455454u;
+    const unsigned int TEXTURE_CACHE_VERSION = 3;
+    const int TEXTURE_CACHE_MAX_LEVELS = 16;
+    struct TextureCacheHeader {
+        unsigned int magic;
+        unsigned int version;
+        unsigned int compressedFormat;
+        unsigned int channels;
+        unsigned int srgb;
+        unsigned int levelCount;
+        unsigned int translucent;
+        unsigned long long sourceSize;
+        long long sourceModified;
+        unsigned long long contentHash;
+    };
+    struct TextureCacheLevel {
+        int width;
+        int height;
+        unsigned long long offset;
+        unsigned long long size;
+    };
+    class TextureCache {
+    public:
+        static void DetectFormats();
+        static bool Load(const std::string& sourceFile, bool srgb, gps::MipChain& chain);
+        static bool Cook(const std::string& sourceFile, bool srgb, gps::MipChain& chain, unsigned long long contentHash = 0);
+        static bool CachedContentHash(const std::string& sourceFile, unsigned long long& contentHash);
+    private:
+        static bool dxt1Supported;
+        static bool dxt5Supported;
+        static bool Translucent(const gps::MipChain& chain);
+        static GLenum CompressedFormat(const gps::MipChain& chain, bool srgb);
+        static void Compress(gps::MipChain& chain, GLenum format);
+        static void EncodeColorBlock(const unsigned char pixels[16][4], unsigned char* out);
+        static void EncodeAlphaBlock(const unsigned char pixels[16][4], unsigned char* out);
+        static bool Write(const std::string& sourceFile, bool srgb, const gps::MipChain& chain, unsigned long long contentHash);
+    };
+}
+#endif
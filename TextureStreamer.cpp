@@ -0,0 +1,196 @@
+#include "TextureStreamer.hpp"
+#include "GLState.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+namespace gps {
+    std::deque<TextureUpload> TextureStreamer::queue;
+    GLuint TextureStreamer::pbos[TextureStreamer::PBO_COUNT] = {0};
+    int TextureStreamer::nextPbo = 0;
+    MipChain::MipChain() {
+        image.width = 0;
+        image.height = 0;
+        image.channels = 0;
+        image.pixels = NULL;
+        compressedFormat = 0;
+        channels = 0;
+    }
+    MipChain::~MipChain() {
+        AssetLoader::FreeImage(image);
+    }
+    void TextureStreamer::BuildMipChain(gps::MipChain& chain, bool srgb) {
+        float toLinear[256];
+        for (int i = 0; i < 256; i++) {
+            float value = i / 255.0f;
+            toLinear[i] = srgb ? (value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f)) : value;
+        }
+        SingleLevel(chain);
+        int channels = chain.channels;
+        int alphaChannel = channels == 4 ? 3 : -1;
+        int width = chain.image.width;
+        int height = chain.image.height;
+        chain.storage.reserve(32);
+        while (width > 1 || height > 1) {
+            const unsigned char* source = chain.levels.back().data;
+            int levelWidth = std::max(1, width / 2);
+            int levelHeight = std::max(1, height / 2);
+            std::vector<unsigned char> level((size_t)levelWidth * levelHeight * channels);
+            for (int y = 0; y < levelHeight; y++) {
+                int y0 = std::min(y * 2, height - 1);
+                int y1 = std::min(y * 2 + 1, height - 1);
+                for (int x = 0; x < levelWidth; x++) {
+                    int x0 = std::min(x * 2, width - 1);
+                    int x1 = std::min(x * 2 + 1, width - 1);
+                    for (int c = 0; c < channels; c++) {
+                        unsigned char a = source[((size_t)y0 * width + x0) * channels + c];
+                        unsigned char b = source[((size_t)y0 * width + x1) * channels + c];
+                        unsigned char d = source[((size_t)y1 * width + x0) * channels + c];
+                        unsigned char e = source[((size_t)y1 * width + x1) * channels + c];
+                        float average;
+                        if (c == alphaChannel) {
+                            average = (a + b + d + e) / (4.0f * 255.0f);
+                        } else {
+                            average = (toLinear[a] + toLinear[b] + toLinear[d] + toLinear[e]) * 0.25f;
+                            if (srgb) {
+                                average = average <= 0.0031308f ? average * 12.92f : 1.055f * powf(average, 1.0f / 2.4f) - 0.055f;
+                            }
+                        }
+                        level[((size_t)y * levelWidth + x) * channels + c] = (unsigned char)(std::min(1.0f, std::max(0.0f, average)) * 255.0f + 0.5f);
+                    }
+                }
+            }
+            chain.storage.push_back(level);
+            MipLevel mip = { levelWidth, levelHeight, chain.storage.back().data(), chain.storage.back().size() };
+            chain.levels.push_back(mip);
+            width = levelWidth;
+            height = levelHeight;
+        }
+    }
+    void TextureStreamer::SingleLevel(gps::MipChain& chain) {
+        chain.channels = chain.image.channels;
+        chain.compressedFormat = 0;
+        chain.storage.clear();
+        chain.levels.clear();
+        MipLevel base = { chain.image.width, chain.image.height, chain.image.pixels, (size_t)chain.image.width * chain.image.height * chain.image.channels };
+        chain.levels.push_back(base);
+    }
+    size_t TextureStreamer::ChainBytes(const gps::MipChain& chain) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < chain.levels.size(); i++) {
+            bytes += chain.levels[i].size;
+        }
+        return bytes;
+    }
+    void TextureStreamer::Placeholder(GLuint texture) {
+        const unsigned char grey[4] = { 128, 128, 128, 255 };
+        GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    void TextureStreamer::Enqueue(GLuint texture, std::shared_ptr<void> owner, GLenum internalFormat, GLenum format, std::shared_ptr<gps::MipChain> mips) {
+        TextureUpload upload;
+        upload.texture = texture;
+        upload.owner = owner;
+        upload.internalFormat = internalFormat;
+        upload.format = format;
+        upload.mips = mips;
+        upload.allocated = false;
+        upload.nextLevel = (int)mips->levels.size() - 1;
+        upload.nextRow = 0;
+        queue.push_back(upload);
+    }
+    void TextureStreamer::Update(double budgetMs) {
+        if (queue.empty()) {
+            return;
+        }
+        if (pbos[0] == 0) {
+            glGenBuffers(PBO_COUNT, pbos);
+        }
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        while (!queue.empty()) {
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            if (elapsedMs >= budgetMs) {
+                break;
+            }
+            TextureUpload& upload = queue.front();
+            GLState::BindTexture(0, GL_TEXTURE_2D, upload.texture);
+            if (!upload.allocated) {
+                Allocate(upload);
+            }
+            UploadRows(upload);
+            if (upload.nextLevel < 0) {
+                queue.pop_front();
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    size_t TextureStreamer::PendingCount() {
+        return queue.size();
+    }
+    void TextureStreamer::Allocate(TextureUpload& upload) {
+        const gps::MipChain& chain = *upload.mips;
+        int levelCount = (int)chain.levels.size();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (int level = 0; level < levelCount; level++) {
+            const MipLevel& mip = chain.levels[level];
+            if (chain.compressedFormat != 0) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, chain.compressedFormat, mip.width, mip.height, 0, (GLsizei)mip.size, NULL);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, level, upload.internalFormat, mip.width, mip.height, 0, upload.format, GL_UNSIGNED_BYTE, NULL);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        upload.allocated = true;
+    }
+    int TextureStreamer::BlockRows(const gps::MipChain& chain) {
+        return chain.compressedFormat != 0 ? 4 : 1;
+    }
+    void TextureStreamer::UploadRows(TextureUpload& upload) {
+        const gps::MipChain& chain = *upload.mips;
+        int level = upload.nextLevel;
+        const MipLevel& mip = chain.levels[level];
+        int blockRows = BlockRows(chain);
+        int blockLines = (mip.height + blockRows - 1) / blockRows;
+        size_t lineBytes = mip.size / blockLines;
+        int lines = (int)std::max((size_t)1, CHUNK_BYTES / lineBytes);
+        int firstLine = upload.nextRow / blockRows;
+        lines = std::min(lines, blockLines - firstLine);
+        int rows = std::min(lines * blockRows, mip.height - upload.nextRow);
+        size_t bytes = lineBytes * lines;
+        const unsigned char* rowData = mip.data + lineBytes * firstLine;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+        nextPbo = (nextPbo + 1) % PBO_COUNT;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        const GLvoid* source = (const GLvoid*)0;
+        if (mapped) {
+            memcpy(mapped, rowData, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        } else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            source = rowData;
+        }
+        if (chain.compressedFormat != 0) {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, upload.nextRow, mip.width, rows, chain.compressedFormat, (GLsizei)bytes, source);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, upload.nextRow, mip.width, rows, upload.format, GL_UNSIGNED_BYTE, source);
+        }
+        upload.nextRow += rows;
+        if (upload.nextRow >= mip.height) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            upload.nextLevel--;
+            upload.nextRow = 0;
+        }
+    }
+}
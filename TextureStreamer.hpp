@@ -0,0 +1,64 @@
+#ifndef TextureStreamer_hpp
+#define TextureStreamer_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include "AssetLoader.hpp"
+#include "MappedFile.hpp"
+#include <deque>
+#include <memory>
+#include <vector>
+namespace gps {
+    struct MipLevel {
+        int width;
+        int height;
+        const unsigned char* data;
+        size_t size;
+    };
+    struct MipChain {
+        gps::DecodedImage image;
+        std::vector<std::vector<unsigned char> > storage;
+        std::shared_ptr<gps::MappedFile> file;
+        std::vector<gps::MipLevel> levels;
+        GLenum compressedFormat;
+        int channels;
+        MipChain();
+        ~MipChain();
+        MipChain(const MipChain&) = delete;
+        MipChain& operator=(const MipChain&) = delete;
+    };
+    struct TextureUpload {
+        GLuint texture;
+        std::shared_ptr<void> owner;
+        GLenum internalFormat;
+        GLenum format;
+        std::shared_ptr<gps::MipChain> mips;
+        bool allocated;
+        int nextLevel;
+        int nextRow;
+    };
+    class TextureStreamer {
+    public:
+        static const int PBO_COUNT = 3;
+        static const size_t CHUNK_BYTES = 1024 * 1024;
+        static void BuildMipChain(gps::MipChain& chain, bool srgb);
+        static void SingleLevel(gps::MipChain& chain);
+        static size_t ChainBytes(const gps::MipChain& chain);
+        static void Placeholder(GLuint texture);
+        static void Enqueue(GLuint texture, std::shared_ptr<void> owner, GLenum internalFormat, GLenum format, std::shared_ptr<gps::MipChain> mips);
+        static void Update(double budgetMs);
+        static size_t PendingCount();
+    private:
+        static std::deque<TextureUpload> queue;
+        static GLuint pbos[PBO_COUNT];
+        static int nextPbo;
+        static void Allocate(TextureUpload& upload);
+        static void UploadRows(TextureUpload& upload);
+        static int BlockRows(const gps::MipChain& chain);
+    };
+}
+#endif
@@ -0,0 +1,117 @@
+#include "TriangleBvh.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+namespace gps {
+    void TriangleBvh::Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+        size_t count = indices.size() / 3;
+        std::vector<glm::vec3> triangleMin(count);
+        std::vector<glm::vec3> triangleMax(count);
+        for (size_t t = 0; t < count; t++) {
+            glm::vec3 a = positions[indices[t * 3 + 0]];
+            glm::vec3 b = positions[indices[t * 3 + 1]];
+            glm::vec3 c = positions[indices[t * 3 + 2]];
+            triangleMin[t] = glm::min(a, glm::min(b, c));
+            triangleMax[t] = glm::max(a, glm::max(b, c));
+        }
+        std::vector<unsigned int> order;
+        Bvh::Build(triangleMin, triangleMax, nodes, order);
+        triangles.resize(count);
+        for (size_t t = 0; t < count; t++) {
+            const unsigned int* corners = &indices[order[t] * 3];
+            glm::vec3 a = positions[corners[0]];
+            triangles[t].vertex = a;
+            triangles[t].edge1 = positions[corners[1]] - a;
+            triangles[t].edge2 = positions[corners[2]] - a;
+        }
+    }
+    void TriangleBvh::Load(const gps::BvhNode* nodeData, size_t nodeCount, const Triangle* triangleData, size_t triangleCount) {
+        nodes.assign(nodeData, nodeData + nodeCount);
+        triangles.assign(triangleData, triangleData + triangleCount);
+    }
+    bool TriangleBvh::Intersect(glm::vec3 origin, glm::vec3 direction, float& distance, int& triangle) const {
+        if (nodes.empty()) {
+            return false;
+        }
+        BvhRay ray = Bvh::PrepareRay(origin, direction);
+        if (Bvh::IntersectBox(ray, nodes[0], distance) == FLT_MAX) {
+            return false;
+        }
+        bool hit = false;
+        unsigned int stack[Bvh::STACK_SIZE];
+        int stackSize = 0;
+        unsigned int nodeIndex = 0;
+        while (true) {
+            const BvhNode& node = nodes[nodeIndex];
+            if (node.count > 0) {
+                for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                    const Triangle& tri = triangles[i];
+                    glm::vec3 p = glm::cross(direction, tri.edge2);
+                    float determinant = glm::dot(tri.edge1, p);
+                    if (std::abs(determinant) < 1e-12f) {
+                        continue;
+                    }
+                    float inverseDeterminant = 1.0f / determinant;
+                    glm::vec3 s = origin - tri.vertex;
+                    float u = glm::dot(s, p) * inverseDeterminant;
+                    if (u < 0.0f || u > 1.0f) {
+                        continue;
+                    }
+                    glm::vec3 q = glm::cross(s, tri.edge1);
+                    float v = glm::dot(direction, q) * inverseDeterminant;
+                    if (v < 0.0f || u + v > 1.0f) {
+                        continue;
+                    }
+                    float t = glm::dot(tri.edge2, q) * inverseDeterminant;
+                    if (t >= 0.0f && t < distance) {
+                        distance = t;
+                        triangle = (int)i;
+                        hit = true;
+                    }
+                }
+            } else {
+                unsigned int nearChild = node.leftFirst;
+                unsigned int farChild = node.leftFirst + 1;
+                float nearDistance = Bvh::IntersectBox(ray, nodes[nearChild], distance);
+                float farDistance = Bvh::IntersectBox(ray, nodes[farChild], distance);
+                if (farDistance < nearDistance) {
+                    std::swap(nearChild, farChild);
+                    std::swap(nearDistance, farDistance);
+                }
+                if (nearDistance != FLT_MAX) {
+                    if (farDistance != FLT_MAX) {
+                        stack[stackSize++] = farChild;
+                    }
+                    nodeIndex = nearChild;
+                    continue;
+                }
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            nodeIndex = stack[--stackSize];
+        }
+        return hit;
+    }
+    glm::vec3 TriangleBvh::Normal(int triangle) const {
+        return glm::cross(triangles[triangle].edge1, triangles[triangle].edge2);
+    }
+    glm::vec3 TriangleBvh::BoundsMin() const {
+        return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMin;
+    }
+    glm::vec3 TriangleBvh::BoundsMax() const {
+        return nodes.empty() ? glm::vec3(0.0f) : nodes[0].boundsMax;
+    }
+    size_t TriangleBvh::TriangleCount() const {
+        return triangles.size();
+    }
+    size_t TriangleBvh::NodeCount() const {
+        return nodes.size();
+    }
+    const std::vector<gps::BvhNode>& TriangleBvh::Nodes() const {
+        return nodes;
+    }
+    const std::vector<TriangleBvh::Triangle>& TriangleBvh::Triangles() const {
+        return triangles;
+    }
+}
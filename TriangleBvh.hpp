@@ -0,0 +1,29 @@
+#ifndef TriangleBvh_hpp
+#define TriangleBvh_hpp
+#include <glm/glm.hpp>
+#include <vector>
+#include "Bvh.hpp"
+namespace gps {
+    class TriangleBvh {
+    public:
+        struct Triangle {
+            glm::vec3 vertex;
+            glm::vec3 edge1;
+            glm::vec3 edge2;
+        };
+        void Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+        void Load(const gps::BvhNode* nodeData, size_t nodeCount, const Triangle* triangleData, size_t triangleCount);
+        bool Intersect(glm::vec3 origin, glm::vec3 direction, float& distance, int& triangle) const;
+        glm::vec3 Normal(int triangle) const;
+        glm::vec3 BoundsMin() const;
+        glm::vec3 BoundsMax() const;
+        size_t TriangleCount() const;
+        size_t NodeCount() const;
+        const std::vector<gps::BvhNode>& Nodes() const;
+        const std::vector<Triangle>& Triangles() const;
+    private:
+        std::vector<gps::BvhNode> nodes;
+        std::vector<Triangle> triangles;
+    };
+}
+#endif
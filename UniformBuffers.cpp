@@ -0,0 +1,41 @@
+#include "UniformBuffers.hpp"
+#include "Shader.hpp"
+#include <cstring>
+namespace gps {
+    static GLsizeiptr AlignUp(GLsizeiptr value, GLsizeiptr alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+    UniformBuffers::UniformBuffers() {
+        memset((void*)&frame, 0, sizeof(frame));
+        memset((void*)&lights, 0, sizeof(lights));
+        memset((void*)&shadow, 0, sizeof(shadow));
+        ubo = 0;
+        frameOffset = 0;
+        lightsOffset = 0;
+        shadowOffset = 0;
+    }
+    void UniformBuffers::Init() {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        frameOffset = 0;
+        lightsOffset = AlignUp(frameOffset + sizeof(FrameBlock), alignment);
+        shadowOffset = AlignUp(lightsOffset + sizeof(LightBlock), alignment);
+        GLsizeiptr totalSize = shadowOffset + sizeof(ShadowBlock);
+        staging.assign(totalSize, 0);
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, totalSize, NULL, GL_DYNAMIC_DRAW);
+        glBindBufferRange(GL_UNIFORM_BUFFER, gps::Shader::BLOCK_FRAME_DATA, ubo, frameOffset, sizeof(FrameBlock));
+        glBindBufferRange(GL_UNIFORM_BUFFER, gps::Shader::BLOCK_LIGHT_DATA, ubo, lightsOffset, sizeof(LightBlock));
+        glBindBufferRange(GL_UNIFORM_BUFFER, gps::Shader::BLOCK_SHADOW_DATA, ubo, shadowOffset, sizeof(ShadowBlock));
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    void UniformBuffers::Upload() {
+        memcpy(&staging[frameOffset], &frame, sizeof(FrameBlock));
+        memcpy(&staging[lightsOffset], &lights, sizeof(LightBlock));
+        memcpy(&staging[shadowOffset], &shadow, sizeof(ShadowBlock));
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)staging.size(), staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef UniformBuffers_hpp
+#define UniformBuffers_hpp
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+#include <glm/glm.hpp>
+#include <vector>
+namespace gps {
+    const int MAX_POINT_LIGHTS = 6;
+    struct FrameBlock {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 lightDir;
+        float padding0;
+        glm::vec3 lightColor;
+        float padding1;
+    };
+    struct PointLightBlock {
+        glm::vec3 position;
+        float constant;
+        glm::vec3 color;
+        float linear;
+        float quadratic;
+        float padding[3];
+    };
+    struct SpotLightBlock {
+        glm::vec3 position;
+        float cutOff;
+        glm::vec3 direction;
+        float outerCutOff;
+        glm::vec3 color;
+        float constant;
+        float linear;
+        float quadratic;
+        int active;
+        float padding;
+    };
+    struct LightBlock {
+        PointLightBlock pointLights[MAX_POINT_LIGHTS];
+        SpotLightBlock spotLight;
+        int nrPointLights;
+        int padding[3];
+    };
+    struct ShadowBlock {
+        glm::mat4 lightSpaceMatrix;
+    };
+    class UniformBuffers {
+    public:
+        FrameBlock frame;
+        LightBlock lights;
+        ShadowBlock shadow;
+        UniformBuffers();
+        void Init();
+        void Upload();
+    private:
+        GLuint ubo;
+        GLsizeiptr frameOffset;
+        GLsizeiptr lightsOffset;
+        GLsizeiptr shadowOffset;
+        std::vector<unsigned char> staging;
+    };
+}
+#endif
@@ -5,13 +5,25 @@
 #include <iostream>
 #include <GLFW/glfw3.h>
 #include <cstdlib> 
+#include <cmath>
+#include <algorithm>
 namespace gps {
+    const float FOG_DENSITY = 0.002f;
+    const float FOG_CUTOFF = sqrtf(logf(255.0f)) / FOG_DENSITY;
+    const float SORT_DEPTH_RANGE = 2000.0f;
+    const float LOD_PIXEL_ERROR = 1.0f;
+    const float LOD_HYSTERESIS = 0.25f;
+    const float OCCLUDER_DISTANCE = 600.0f;
+    const float SPIRE_HEIGHT = 160.0f;
+    const float SPIRE_RADIUS = 6.0f;
+    const float BULLET_RADIUS = 0.5f;
+    const int SWEEP_REFINE_STEPS = 8;
     World::World() {
     }
-    void World::Init() {
-        ground.Load("textures/ground.png");
-        rock.LoadModel("models/kenney_space-kit/Models/OBJ format/rock_largeA.obj");
-        crater.LoadModel("models/kenney_space-kit/Models/OBJ format/craterLarge.obj");
+    void World::Init(gps::AssetLoader& loader) {
+        ground.Load("textures/ground.png", loader);
+        rock.LoadModel("models/kenney_space-kit/Models/OBJ format/rock_largeA.obj", loader);
+        crater.LoadModel("models/kenney_space-kit/Models/OBJ format/craterLarge.obj", loader);
         skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
         std::vector<std::string> faces;
         faces.push_back("textures/skybox/right.png");
@@ -20,7 +32,7 @@ namespace gps {
         faces.push_back("textures/skybox/bottom.png");
         faces.push_back("textures/skybox/back.png");
         faces.push_back("textures/skybox/front.png");
-        skyBox.Load(faces);
+        skyBox.Load(faces, loader);
         obstacles.push_back({glm::vec3(100.0f, 0.0f, 100.0f), 30.0f});
         obstacles.push_back({glm::vec3(200.0f, 0.0f, -150.0f), 45.0f});
         obstacles.push_back({glm::vec3(-150.0f, 0.0f, 120.0f), 35.0f});
@@ -30,13 +42,13 @@ namespace gps {
             float z = (rand() % 800) - 400.0f;
             spirePositions.push_back(glm::vec3(x, 0.0f, z));
         }
-        building.LoadModel("models/kenney_space-kit/Models/OBJ format/hangar_largeA.obj");
-        alien.LoadModel("models/kenney_space-kit/Models/OBJ format/alien.obj");
-        sun.LoadModel("models/kenney_space-kit/Models/OBJ format/rock_largeA.obj"); 
-        nitroModel.LoadModel("models/kenney_space-kit/Models/OBJ format/rocket_fuelA.obj"); 
-        tower1.LoadModel("models/tower1/base.obj");
-        tower2.LoadModel("models/tower2/base.obj");
-        newAlien.LoadModel("models/new_alien/base.obj");
+        building.LoadModel("models/kenney_space-kit/Models/OBJ format/hangar_largeA.obj", loader);
+        alien.LoadModel("models/kenney_space-kit/Models/OBJ format/alien.obj", loader);
+        sun.LoadModel("models/kenney_space-kit/Models/OBJ format/rock_largeA.obj", loader); 
+        nitroModel.LoadModel("models/kenney_space-kit/Models/OBJ format/rocket_fuelA.obj", loader); 
+        tower1.LoadModel("models/tower1/base.obj", loader);
+        tower2.LoadModel("models/tower2/base.obj", loader);
+        newAlien.LoadModel("models/new_alien/base.obj", loader);
         int numBuildings = 200; 
         for(int i=0; i<numBuildings; ++i) {
             float x = (rand() % 2400) - 1200.0f;
@@ -51,6 +63,7 @@ namespace gps {
             }
             if(collision) continue;
             BuildingInstance inst;
+            inst.lod = 0;
             inst.position = glm::vec3(x, 0.1f, z);
             inst.rotation = (float)(rand() % 360);
             int rType = rand() % 100;
@@ -72,7 +85,7 @@ namespace gps {
                  for(int a=0; a<3; ++a) {
                      glm::vec3 alienPos = inst.position + (fwd * 80.0f) + (glm::vec3(m * glm::vec4(1,0,0,0)) * (float)(a-1) * 25.0f);
                      alienPos.y = 0.0f;
-                     alienInstances.push_back({alienPos, alienType, 4}); 
+                     alienInstances.push_back({alienPos, alienType, 4, 0, -1}); 
                  }
             } else if (inst.type == 1) {
                  inst.scale = glm::vec3(20.0f, 20.0f, 20.0f);
@@ -87,7 +100,7 @@ namespace gps {
              float x = (rand() % 2400) - 1200.0f;
              float z = (rand() % 2400) - 1200.0f;
              if (std::abs(x) < 200.0f && std::abs(z) < 200.0f) continue;
-             alienInstances.push_back({glm::vec3(x, 10.0f, z), 1, 4}); 
+             alienInstances.push_back({glm::vec3(x, 10.0f, z), 1, 4, 0, -1}); 
         }
         int numBuildingsRing = 800; 
         float ringRadius = 1800.0f; 
@@ -100,6 +113,7 @@ namespace gps {
             float x = r * cos(glm::radians(angle));
             float z = r * sin(glm::radians(angle));
             BuildingInstance inst;
+            inst.lod = 0;
             inst.position = glm::vec3(x, 0.1f, z);
             inst.rotation = (float)(rand() % 360);
             inst.color = glm::vec3(1.0f); 
@@ -118,9 +132,36 @@ namespace gps {
             }
             cityBuildings.push_back(inst);
             if (i % 5 == 0) {
-                 alienInstances.push_back({glm::vec3(x, 20.0f, z), 1, 4}); 
+                 alienInstances.push_back({glm::vec3(x, 20.0f, z), 1, 4, 0, -1}); 
             }
         }
+        for (const auto& obs : obstacles) {
+            AddCollider(COLLIDER_OBSTACLE, obs.position, obs.radius, 0.0f);
+        }
+        for (const auto& spirePos : spirePositions) {
+            AddCollider(COLLIDER_SPIRE, spirePos, SPIRE_RADIUS, SPIRE_HEIGHT);
+        }
+        for (auto& inst : cityBuildings) {
+            inst.collider = AddCollider(COLLIDER_BUILDING, inst.position, inst.scale.x * 0.8f, inst.scale.y * 1.5f);
+        }
+        for (size_t b = 0; b < cityBuildings.size(); b++) {
+            BuildingInstance& inst = cityBuildings[b];
+            inst.target = AddTarget(TARGET_BUILDING, (int)b, inst.position, inst.scale.x * 2.5f, inst.scale.y * 2.0f);
+        }
+        for (size_t a = 0; a < alienInstances.size(); a++) {
+            AlienInstance& inst = alienInstances[a];
+            inst.target = AddTarget(TARGET_ALIEN, (int)a, inst.position, inst.type == 1 ? 15.0f : 8.0f, 0.0f);
+        }
+        if (InstanceCuller::Supported()) {
+            instanceCuller.Init();
+            gps::Model3D* cullTargets[] = { &building, &tower1, &tower2, &alien, &newAlien };
+            for (int i = 0; i < 5; i++) {
+                cullModels[i] = instanceCuller.AddModel(cullTargets[i]);
+            }
+            gpuCulling = true;
+        }
+        occluderShader.loadShader("shaders/hiZDepth.vert", "shaders/hiZDepth.frag");
+        hiZBuffer.Init(!gpuCulling);
     }
     void World::Update(float delta) {
         asteroidPositions.clear();
@@ -138,154 +179,538 @@ namespace gps {
             asteroidPositions.push_back(pos);
             dynamicObstacles.push_back({pos, 25.0f});
         }
-        for (int i = 0; i < bullets.size(); ) {
-            bullets[i].position += bullets[i].velocity * delta;
-            bullets[i].life -= delta;
-            if (bullets[i].life < 0) {
-                bullets.erase(bullets.begin() + i);
-                continue;
-            }
-            bool hit = false;
-            for (int b = 0; b < cityBuildings.size(); ++b) {
-                float buildingRadius = cityBuildings[b].scale.x * 2.5f; 
-                float buildingHeight = cityBuildings[b].scale.y * 2.0f;
-                if (bullets[i].position.y < 0.0f || bullets[i].position.y > (cityBuildings[b].position.y + buildingHeight)) {
-                     continue; 
-                }
-                float distXZ = glm::distance(glm::vec2(bullets[i].position.x, bullets[i].position.z), 
-                                             glm::vec2(cityBuildings[b].position.x, cityBuildings[b].position.z));
-                if (distXZ < buildingRadius) {
-                    cityBuildings[b].health--;
-                    hit = true;
-                    if (cityBuildings[b].health <= 0) {
-                        cityBuildings.erase(cityBuildings.begin() + b);
-                    }
-                    break;
-                }
-            }
-            if (!hit) {
-                for (int a = 0; a < alienInstances.size(); ++a) {
-                    float alienRadius = 8.0f;
-                    if (alienInstances[a].type == 1) alienRadius = 15.0f; 
-                    float dist = glm::distance(bullets[i].position, alienInstances[a].position);
-                    if (dist < alienRadius) {
-                        alienInstances[a].health--;
-                        hit = true;
-                        if (alienInstances[a].health <= 0) {
-                            alienInstances.erase(alienInstances.begin() + a);
-                        }
-                        break;
-                    }
-                }
-            }
+        RefreshCollisionProxies();
+        RefreshRayScene();
+        bulletRays.resize(bullets.Size());
+        for (size_t i = 0; i < bullets.Size(); i++) {
+            float speed = glm::length(bullets.Velocity(i));
+            bulletRays[i].origin = bullets.Position(i);
+            bulletRays[i].direction = bullets.Velocity(i) / speed;
+            bulletRays[i].maxDistance = speed * delta;
+        }
+        rayScene.RayCast(bulletRays, bulletHits);
+        bullets.Advance(delta);
+        for (size_t i = 0; i < bullets.Size(); ) {
+            bool hit = bulletHits[i].hit;
             if (hit) {
-                bullets.erase(bullets.begin() + i);
+                DamageTarget(bulletHits[i].owner);
+            }
+            if (bullets.Life(i) < 0 || hit || HitTargets(bullets.Position(i))) {
+                bullets.Remove(i);
+                bulletHits[i] = bulletHits.back();
+                bulletHits.pop_back();
             } else {
                 i++;
             }
         }
     }
+    void World::RefreshRayScene() {
+        gps::Model3D* buildingModels[] = { &building, &tower1, &tower2 };
+        gps::Model3D* alienModels[] = { &alien, &newAlien };
+        int readyModels = 0;
+        for (int i = 0; i < 3; i++) {
+            readyModels += buildingModels[i]->CollisionMesh() != NULL ? 1 : 0;
+        }
+        for (int i = 0; i < 2; i++) {
+            readyModels += alienModels[i]->CollisionMesh() != NULL ? 1 : 0;
+        }
+        if (!raySceneDirty && readyModels == raySceneModels) {
+            return;
+        }
+        rayScene.Clear();
+        for (const auto& inst : cityBuildings) {
+            rayScene.AddInstance(buildingModels[inst.type]->CollisionMesh(), ModelMatrix(inst.position, inst.rotation, inst.scale), inst.target);
+        }
+        for (const auto& alienInst : alienInstances) {
+            if (alienInst.type == 0) {
+                rayScene.AddInstance(alien.CollisionMesh(), ModelMatrix(alienInst.position, 0.0f, glm::vec3(8.0f)), alienInst.target);
+            } else {
+                rayScene.AddInstance(newAlien.CollisionMesh(), ModelMatrix(alienInst.position, 0.0f, glm::vec3(12.0f)), alienInst.target);
+            }
+        }
+        rayScene.Build();
+        raySceneDirty = false;
+        raySceneModels = readyModels;
+    }
+    void World::RayCast(const std::vector<gps::Ray>& rays, std::vector<gps::RayHit>& hits) const {
+        rayScene.RayCast(rays, hits);
+    }
+    gps::RayHit World::Pick(glm::vec3 origin, glm::vec3 direction, float maxDistance) const {
+        gps::Ray ray = { origin, glm::normalize(direction), maxDistance };
+        return rayScene.RayCast(ray);
+    }
     void World::FireBullet(glm::vec3 position, glm::vec3 direction) {
-        Bullet b;
-        b.position = position;
-        b.velocity = glm::normalize(direction) * 400.0f; 
-        b.life = 3.0f; 
-        bullets.push_back(b);
+        bullets.Add(position, glm::normalize(direction) * 400.0f, 3.0f);
     }
-    bool World::CheckCollision(glm::vec3 position, float radius) {
-        for (const auto& obs : obstacles) {
-            float dist = glm::distance(position, obs.position);
-            if (dist < (radius + obs.radius)) {
-                return true;
+    bool World::HitTargets(glm::vec3 position) {
+        glm::vec2 point = glm::vec2(position.x, position.z);
+        targetGrid.Query(point, point, targetQuery);
+        int hit = -1;
+        for (size_t i = 0; i < targetQuery.size(); i++) {
+            const HitTarget& target = targets[targetQuery[i]];
+            if (!TargetHit(target, position)) {
+                continue;
+            }
+            if (target.type == TARGET_BUILDING) {
+                hit = targetQuery[i];
+                break;
+            }
+            if (hit < 0) {
+                hit = targetQuery[i];
+            }
+        }
+        if (hit < 0) {
+            return false;
+        }
+        DamageTarget(hit);
+        return true;
+    }
+    void World::DamageTarget(int id) {
+        const HitTarget& target = targets[id];
+        if (target.index < 0) {
+            return;
+        }
+        if (target.type == TARGET_BUILDING) {
+            if (--cityBuildings[target.index].health <= 0) {
+                RemoveBuilding(target.index);
+            }
+        } else if (--alienInstances[target.index].health <= 0) {
+            RemoveAlien(target.index);
+        }
+    }
+    bool World::TargetHit(const HitTarget& target, glm::vec3 position) const {
+        if (target.proxy.hull != NULL) {
+            return ProxyOverlaps(target.proxy, position, BULLET_RADIUS);
+        }
+        glm::vec3 offset = position - target.position;
+        if (target.type == TARGET_ALIEN) {
+            return glm::dot(offset, offset) < target.radius * target.radius;
+        }
+        if (position.y < 0.0f || position.y > target.position.y + target.height) {
+            return false;
+        }
+        return offset.x * offset.x + offset.z * offset.z < target.radius * target.radius;
+    }
+    void World::RemoveBuilding(int index) {
+        RemoveCollider(cityBuildings[index].collider);
+        RemoveTarget(cityBuildings[index].target);
+        if (index != (int)cityBuildings.size() - 1) {
+            cityBuildings[index] = cityBuildings.back();
+            targets[cityBuildings[index].target].index = index;
+        }
+        cityBuildings.pop_back();
+        cullInstancesDirty = true;
+        raySceneDirty = true;
+    }
+    void World::RemoveAlien(int index) {
+        RemoveTarget(alienInstances[index].target);
+        if (index != (int)alienInstances.size() - 1) {
+            alienInstances[index] = alienInstances.back();
+            targets[alienInstances[index].target].index = index;
+        }
+        alienInstances.pop_back();
+        cullInstancesDirty = true;
+        raySceneDirty = true;
+    }
+    int World::AddTarget(TargetType type, int index, glm::vec3 position, float radius, float height) {
+        CollisionProxy proxy = { NULL, glm::mat4(1.0f), position, position };
+        glm::vec2 center = glm::vec2(position.x, position.z);
+        HitTarget target = { type, index, position, radius, height, proxy, center - glm::vec2(radius), center + glm::vec2(radius) };
+        int id = (int)targets.size();
+        if (!freeTargets.empty()) {
+            id = freeTargets.back();
+            freeTargets.pop_back();
+            targets[id] = target;
+        } else {
+            targets.push_back(target);
+        }
+        targetGrid.Insert(id, target.gridMin, target.gridMax);
+        return id;
+    }
+    void World::RemoveTarget(int id) {
+        targetGrid.Remove(id, targets[id].gridMin, targets[id].gridMax);
+        targets[id].index = -1;
+        freeTargets.push_back(id);
+    }
+    bool World::SweepSphere(glm::vec3 start, glm::vec3 move, float radius, SweepHit& hit) {
+        glm::vec3 end = start + move;
+        glm::vec2 boundsMin = glm::vec2(std::min(start.x, end.x) - radius, std::min(start.z, end.z) - radius);
+        glm::vec2 boundsMax = glm::vec2(std::max(start.x, end.x) + radius, std::max(start.z, end.z) + radius);
+        collisionGrid.Query(boundsMin, boundsMax, colliderQuery);
+        bool found = false;
+        hit.time = 1.0f;
+        hit.position = end;
+        hit.normal = glm::vec3(0.0f);
+        SweepHit candidate;
+        for (size_t i = 0; i < colliderQuery.size(); i++) {
+            const Collider& collider = colliders[colliderQuery[i]];
+            bool touched = false;
+            if (collider.proxy.hull != NULL) {
+                touched = SweepAgainstProxy(start, move, radius, collider.proxy, candidate);
+            } else if (collider.type == COLLIDER_OBSTACLE) {
+                touched = SweepAgainstSphere(start, move, collider.position, collider.radius + radius, candidate);
+            } else if (collider.type == COLLIDER_SPIRE) {
+                touched = SweepAgainstCylinder(start, move, collider.position, collider.radius + radius, collider.height, candidate);
+            } else {
+                touched = SweepAgainstCylinder(start, move, collider.position, collider.radius + radius, collider.position.y + collider.height + 1.0f, candidate);
+            }
+            if (touched && (!found || candidate.time < hit.time)) {
+                hit = candidate;
+                found = true;
             }
         }
-        float asteroidBaseRadius = 4.0f; 
         for (const auto& asteroid : dynamicObstacles) {
-            float combinedRadius = asteroid.radius * 0.8f + radius; 
-            float dist = glm::length(position - asteroid.position);
-            if (dist < combinedRadius) {
-                return true;
-            }
-        }
-        float spireHeight = 160.0f;
-        float spireRadius = 6.0f; 
-        if (position.y < spireHeight) {
-            for (const auto& spirePos : spirePositions) {
-                float dx = position.x - spirePos.x;
-                float dz = position.z - spirePos.z;
-                float distXZ = sqrt(dx*dx + dz*dz);
-                if (distXZ < (spireRadius + radius)) { 
+            if (SweepAgainstSphere(start, move, asteroid.position, asteroid.radius * 0.8f + radius, candidate) && (!found || candidate.time < hit.time)) {
+                hit = candidate;
+                found = true;
+            }
+        }
+        return found;
+    }
+    bool World::SweepAgainstSphere(glm::vec3 start, glm::vec3 move, glm::vec3 center, float radius, SweepHit& hit) {
+        glm::vec3 offset = start - center;
+        float c = glm::dot(offset, offset) - radius * radius;
+        if (c < 0.0f) {
+            float length = glm::length(offset);
+            hit.time = 0.0f;
+            hit.normal = length > 1e-6f ? offset / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            hit.position = center + hit.normal * radius;
+            return true;
+        }
+        float a = glm::dot(move, move);
+        float b = glm::dot(offset, move);
+        if (a < 1e-12f || b >= 0.0f) {
+            return false;
+        }
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) {
+            return false;
+        }
+        float t = (-b - std::sqrt(discriminant)) / a;
+        if (t > 1.0f) {
+            return false;
+        }
+        hit.time = t;
+        hit.position = start + move * t;
+        hit.normal = glm::normalize(hit.position - center);
+        return true;
+    }
+    bool World::SweepAgainstCylinder(glm::vec3 start, glm::vec3 move, glm::vec3 axis, float radius, float top, SweepHit& hit) {
+        float dx = start.x - axis.x;
+        float dz = start.z - axis.z;
+        float c = dx * dx + dz * dz - radius * radius;
+        if (c < 0.0f && start.y < top) {
+            float distance = std::sqrt(dx * dx + dz * dz);
+            hit.time = 0.0f;
+            if (top - start.y < radius - distance || distance < 1e-6f) {
+                hit.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                hit.position = glm::vec3(start.x, top, start.z);
+            } else {
+                hit.normal = glm::vec3(dx / distance, 0.0f, dz / distance);
+                hit.position = glm::vec3(axis.x, start.y, axis.z) + hit.normal * radius;
+            }
+            return true;
+        }
+        if (c >= 0.0f) {
+            float a = move.x * move.x + move.z * move.z;
+            float b = dx * move.x + dz * move.z;
+            float discriminant = b * b - a * c;
+            if (a > 1e-12f && b < 0.0f && discriminant >= 0.0f) {
+                float t = (-b - std::sqrt(discriminant)) / a;
+                if (t <= 1.0f && start.y + move.y * t < top) {
+                    hit.time = t;
+                    hit.position = start + move * t;
+                    hit.normal = glm::normalize(glm::vec3(hit.position.x - axis.x, 0.0f, hit.position.z - axis.z));
                     return true;
                 }
             }
         }
-        float playerHeight = 2.0f; 
-        for (const auto& building : cityBuildings) {
-            float buildingRadius = building.scale.x * 0.8f; 
-            float buildingHeight = building.scale.y * 1.5f; 
-            if (position.y > (building.position.y + buildingHeight + 1.0f)) {
-                 continue;
-            }
-            float dx = position.x - building.position.x;
-            float dz = position.z - building.position.z;
-            float distXZ = sqrt(dx*dx + dz*dz);
-            if (distXZ < (buildingRadius + radius)) {
-                return true;
+        if (start.y >= top && move.y < 0.0f) {
+            float t = (top - start.y) / move.y;
+            if (t <= 1.0f) {
+                glm::vec3 position = start + move * t;
+                float px = position.x - axis.x;
+                float pz = position.z - axis.z;
+                if (px * px + pz * pz < radius * radius) {
+                    hit.time = t;
+                    hit.position = position;
+                    hit.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                    return true;
+                }
             }
         }
         return false;
     }
+    int World::AddCollider(ColliderType type, glm::vec3 position, float radius, float height) {
+        CollisionProxy proxy = { NULL, glm::mat4(1.0f), position, position };
+        glm::vec2 center = glm::vec2(position.x, position.z);
+        Collider collider = { type, position, radius, height, proxy, center - glm::vec2(radius), center + glm::vec2(radius) };
+        int id = (int)colliders.size();
+        if (!freeColliders.empty()) {
+            id = freeColliders.back();
+            freeColliders.pop_back();
+            colliders[id] = collider;
+        } else {
+            colliders.push_back(collider);
+        }
+        collisionGrid.Insert(id, collider.gridMin, collider.gridMax);
+        return id;
+    }
+    void World::RemoveCollider(int id) {
+        collisionGrid.Remove(id, colliders[id].gridMin, colliders[id].gridMax);
+        freeColliders.push_back(id);
+    }
+    CollisionProxy World::MakeProxy(const gps::ConvexHull* hull, const glm::mat4& transform) {
+        CollisionProxy proxy;
+        proxy.hull = hull;
+        proxy.transform = transform;
+        glm::vec3 localMin = hull->BoundsMin();
+        glm::vec3 localMax = hull->BoundsMax();
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 local = glm::vec3((corner & 1) ? localMax.x : localMin.x, (corner & 2) ? localMax.y : localMin.y, (corner & 4) ? localMax.z : localMin.z);
+            glm::vec3 world = glm::vec3(transform * glm::vec4(local, 1.0f));
+            proxy.boundsMin = corner == 0 ? world : glm::min(proxy.boundsMin, world);
+            proxy.boundsMax = corner == 0 ? world : glm::max(proxy.boundsMax, world);
+        }
+        return proxy;
+    }
+    void World::SetColliderProxy(int id, const CollisionProxy& proxy) {
+        Collider& collider = colliders[id];
+        collisionGrid.Remove(id, collider.gridMin, collider.gridMax);
+        collider.proxy = proxy;
+        collider.gridMin = glm::vec2(proxy.boundsMin.x, proxy.boundsMin.z);
+        collider.gridMax = glm::vec2(proxy.boundsMax.x, proxy.boundsMax.z);
+        collisionGrid.Insert(id, collider.gridMin, collider.gridMax);
+    }
+    void World::SetTargetProxy(int id, const CollisionProxy& proxy) {
+        HitTarget& target = targets[id];
+        targetGrid.Remove(id, target.gridMin, target.gridMax);
+        target.proxy = proxy;
+        target.gridMin = glm::vec2(proxy.boundsMin.x, proxy.boundsMin.z);
+        target.gridMax = glm::vec2(proxy.boundsMax.x, proxy.boundsMax.z);
+        targetGrid.Insert(id, target.gridMin, target.gridMax);
+    }
+    void World::RefreshCollisionProxies() {
+        gps::Model3D* buildingModels[] = { &building, &tower1, &tower2 };
+        gps::Model3D* alienModels[] = { &alien, &newAlien };
+        int readyModels = 0;
+        for (int i = 0; i < 3; i++) {
+            readyModels += buildingModels[i]->CollisionHull() != NULL ? 1 : 0;
+        }
+        for (int i = 0; i < 2; i++) {
+            readyModels += alienModels[i]->CollisionHull() != NULL ? 1 : 0;
+        }
+        if (readyModels == collisionProxyModels) {
+            return;
+        }
+        for (const auto& inst : cityBuildings) {
+            const gps::ConvexHull* hull = buildingModels[inst.type]->CollisionHull();
+            if (hull == NULL || colliders[inst.collider].proxy.hull != NULL) {
+                continue;
+            }
+            CollisionProxy proxy = MakeProxy(hull, ModelMatrix(inst.position, inst.rotation, inst.scale));
+            SetColliderProxy(inst.collider, proxy);
+            SetTargetProxy(inst.target, proxy);
+        }
+        for (const auto& alienInst : alienInstances) {
+            const gps::ConvexHull* hull = alienModels[alienInst.type == 0 ? 0 : 1]->CollisionHull();
+            if (hull == NULL || targets[alienInst.target].proxy.hull != NULL) {
+                continue;
+            }
+            float scale = alienInst.type == 0 ? 8.0f : 12.0f;
+            SetTargetProxy(alienInst.target, MakeProxy(hull, ModelMatrix(alienInst.position, 0.0f, glm::vec3(scale))));
+        }
+        collisionProxyModels = readyModels;
+    }
+    bool World::BoundsOverlap(glm::vec3 aMin, glm::vec3 aMax, glm::vec3 bMin, glm::vec3 bMax) {
+        return aMin.x <= bMax.x && aMax.x >= bMin.x && aMin.y <= bMax.y && aMax.y >= bMin.y && aMin.z <= bMax.z && aMax.z >= bMin.z;
+    }
+    bool World::ProxyOverlaps(const CollisionProxy& proxy, glm::vec3 position, float radius) {
+        if (!BoundsOverlap(position - glm::vec3(radius), position + glm::vec3(radius), proxy.boundsMin, proxy.boundsMax)) {
+            return false;
+        }
+        return Gjk::Intersect(ConvexShape::Sphere(position, radius), ConvexShape::Hull(proxy.hull, proxy.transform));
+    }
+    bool World::SweepAgainstProxy(glm::vec3 start, glm::vec3 move, float radius, const CollisionProxy& proxy, SweepHit& hit) {
+        glm::vec3 end = start + move;
+        if (!BoundsOverlap(glm::min(start, end) - glm::vec3(radius), glm::max(start, end) + glm::vec3(radius), proxy.boundsMin, proxy.boundsMax)) {
+            return false;
+        }
+        ConvexShape hull = ConvexShape::Hull(proxy.hull, proxy.transform);
+        Contact contact;
+        if (Gjk::Intersect(ConvexShape::Sphere(start, radius), hull)) {
+            hit.time = 0.0f;
+            if (Gjk::Penetration(ConvexShape::Sphere(start, radius), hull, contact)) {
+                hit.normal = contact.normal;
+                hit.position = start + contact.normal * contact.depth;
+            } else {
+                hit.normal = ProxyContactNormal(proxy, start, move);
+                hit.position = start;
+            }
+            return true;
+        }
+        float enter = 0.0f;
+        float exit = 1.0f;
+        if (!ClipToBounds(start, move, proxy.boundsMin - glm::vec3(radius), proxy.boundsMax + glm::vec3(radius), enter, exit)) {
+            return false;
+        }
+        int steps = std::max(1, (int)std::ceil(glm::length(move) * (exit - enter) / radius));
+        float freeTime = enter;
+        float hitTime = -1.0f;
+        for (int step = 1; step <= steps; step++) {
+            float t = enter + (exit - enter) * step / steps;
+            if (Gjk::Intersect(ConvexShape::Sphere(start + move * t, radius), hull)) {
+                hitTime = t;
+                break;
+            }
+            freeTime = t;
+        }
+        if (hitTime < 0.0f) {
+            return false;
+        }
+        for (int refine = 0; refine < SWEEP_REFINE_STEPS; refine++) {
+            float t = (freeTime + hitTime) * 0.5f;
+            if (Gjk::Intersect(ConvexShape::Sphere(start + move * t, radius), hull)) {
+                hitTime = t;
+            } else {
+                freeTime = t;
+            }
+        }
+        hit.time = freeTime;
+        hit.position = start + move * freeTime;
+        if (Gjk::Penetration(ConvexShape::Sphere(start + move * hitTime, radius), hull, contact)) {
+            hit.normal = contact.normal;
+        } else {
+            hit.normal = ProxyContactNormal(proxy, hit.position, move);
+        }
+        return true;
+    }
+    bool World::ClipToBounds(glm::vec3 start, glm::vec3 move, glm::vec3 boundsMin, glm::vec3 boundsMax, float& enter, float& exit) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (std::abs(move[axis]) < 1e-6f) {
+                if (start[axis] < boundsMin[axis] || start[axis] > boundsMax[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float t1 = (boundsMin[axis] - start[axis]) / move[axis];
+            float t2 = (boundsMax[axis] - start[axis]) / move[axis];
+            enter = std::max(enter, std::min(t1, t2));
+            exit = std::min(exit, std::max(t1, t2));
+        }
+        return enter <= exit;
+    }
+    glm::vec3 World::ProxyContactNormal(const CollisionProxy& proxy, glm::vec3 position, glm::vec3 move) {
+        glm::vec3 away = position - (proxy.boundsMin + proxy.boundsMax) * 0.5f;
+        if (glm::dot(away, away) > 1e-12f) {
+            return glm::normalize(away);
+        }
+        if (glm::dot(move, move) > 1e-12f) {
+            return -glm::normalize(move);
+        }
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    void World::CollectLights(gps::LightBlock& lights, glm::mat4 viewMatrix) {
+        glm::vec3 crystalPos = glm::vec3(-100.0f, 5.0f, -100.0f); 
+        lights.pointLights[0].position = glm::vec3(viewMatrix * glm::vec4(crystalPos, 1.0f));
+        lights.pointLights[0].color = glm::vec3(0.0f, 1.0f, 0.0f); 
+        lights.pointLights[0].constant = 1.0f;
+        lights.pointLights[0].linear = 0.045f;
+        lights.pointLights[0].quadratic = 0.0075f;
+        lights.nrPointLights = 1;
+    }
     void World::Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, RenderType type) {
         shader.useShaderProgram();
-        if (type == RENDER_ALL) {
-            glm::vec3 crystalPos = glm::vec3(-100.0f, 5.0f, -100.0f); 
-            glm::vec3 crystalPosEye = glm::vec3(viewMatrix * glm::vec4(crystalPos, 1.0f));
-            GLint loc = glGetUniformLocation(shader.shaderProgram, "pointLights[0].position");
-            if (loc >= 0) {
-                glUniform3fv(loc, 1, glm::value_ptr(crystalPosEye));
-                glUniform3fv(glGetUniformLocation(shader.shaderProgram, "pointLights[0].color"), 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f))); 
-                glUniform1f(glGetUniformLocation(shader.shaderProgram, "pointLights[0].constant"), 1.0f);
-                glUniform1f(glGetUniformLocation(shader.shaderProgram, "pointLights[0].linear"), 0.045f);
-                glUniform1f(glGetUniformLocation(shader.shaderProgram, "pointLights[0].quadratic"), 0.0075f);
-                glUniform1i(glGetUniformLocation(shader.shaderProgram, "nrPointLights"), 1);
-            }
-        }
-        RenderMesh(rock, shader, viewMatrix, projectionMatrix, glm::vec3(100.0f, 0.0f, 100.0f), 0.0f, 50.0f, glm::vec3(0.6f));
-        RenderMesh(rock, shader, viewMatrix, projectionMatrix, glm::vec3(200.0f, 0.0f, -150.0f), 90.0f, 80.0f, glm::vec3(0.5f));
-        RenderMesh(rock, shader, viewMatrix, projectionMatrix, glm::vec3(-150.0f, 0.0f, 120.0f), 180.0f, 60.0f, glm::vec3(0.7f));
-        RenderMesh(crater, shader, viewMatrix, projectionMatrix, glm::vec3(-100.0f, -5.0f, -100.0f), 0.0f, 30.0f, glm::vec3(1.0f));
-        RenderMesh(crater, shader, viewMatrix, projectionMatrix, glm::vec3(250.0f, -5.0f, 250.0f), 45.0f, 40.0f, glm::vec3(1.0f));
-        for(const auto& pos : spirePositions) {
-             RenderMesh(rock, shader, viewMatrix, projectionMatrix, pos, 0.0f, glm::vec3(15.0f, 80.0f, 15.0f), glm::vec3(0.4f, 0.4f, 0.5f));
+        cullingShadows = (type == RENDER_SHADOWS);
+        if (cullingShadows) {
+            lightFrustum.ExtractShadowCasterVolume(projectionMatrix * viewMatrix);
+            shadowCullStats.visible = 0;
+            shadowCullStats.culled = 0;
+        } else {
+            viewFrustum.Extract(projectionMatrix * viewMatrix);
+            cullOrigin = glm::vec3(glm::inverse(viewMatrix)[3]);
+            GLint viewport[4];
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            lodScale = projectionMatrix[1][1] * viewport[3] * 0.5f;
+            cullStats.visible = 0;
+            cullStats.culled = 0;
+            lodStats = LodStats();
+            occlusionStats.visible = 0;
+            occlusionStats.occluded = 0;
         }
-        for(const auto& inst : cityBuildings) {
-            if (inst.type == 0) {
-                RenderMesh(building, shader, viewMatrix, projectionMatrix, inst.position, inst.rotation, inst.scale, inst.color);
-            } else if (inst.type == 1) {
-                RenderMesh(tower1, shader, viewMatrix, projectionMatrix, inst.position, inst.rotation, inst.scale, inst.color);
-            } else if (inst.type == 2) {
-                RenderMesh(tower2, shader, viewMatrix, projectionMatrix, inst.position, inst.rotation, inst.scale, inst.color);
+        ModelBatch* batches[] = { &rockBatch, &craterBatch, &hangarBatch, &tower1Batch, &tower2Batch, &alienBatch, &newAlienBatch, &sunBatch };
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            for (int l = 0; l < gps::Model3D::MAX_LODS; l++) {
+                batches[b]->lods[l].clear();
             }
         }
-        for(const auto& alienInst : alienInstances) {
-             if (alienInst.type == 0) {
-                 RenderMesh(alien, shader, viewMatrix, projectionMatrix, alienInst.position, 0.0f, 8.0f, glm::vec3(0.2f, 0.8f, 0.2f));
-             } else {
-                 RenderMesh(newAlien, shader, viewMatrix, projectionMatrix, alienInst.position, 0.0f, 12.0f, glm::vec3(1.0f)); 
-             }
+        AddInstance(rockBatch, rock, ModelMatrix(glm::vec3(100.0f, 0.0f, 100.0f), 0.0f, glm::vec3(50.0f)), glm::vec3(0.6f));
+        AddInstance(rockBatch, rock, ModelMatrix(glm::vec3(200.0f, 0.0f, -150.0f), 90.0f, glm::vec3(80.0f)), glm::vec3(0.5f));
+        AddInstance(rockBatch, rock, ModelMatrix(glm::vec3(-150.0f, 0.0f, 120.0f), 180.0f, glm::vec3(60.0f)), glm::vec3(0.7f));
+        AddInstance(craterBatch, crater, ModelMatrix(glm::vec3(-100.0f, -5.0f, -100.0f), 0.0f, glm::vec3(30.0f)), glm::vec3(1.0f));
+        AddInstance(craterBatch, crater, ModelMatrix(glm::vec3(250.0f, -5.0f, 250.0f), 45.0f, glm::vec3(40.0f)), glm::vec3(1.0f));
+        for(const auto& pos : spirePositions) {
+             AddInstance(rockBatch, rock, ModelMatrix(pos, 0.0f, glm::vec3(15.0f, 80.0f, 15.0f)), glm::vec3(0.4f, 0.4f, 0.5f));
+        }
+        bool occlusionPass = occlusionCulling && !cullingShadows;
+        if (occlusionPass) {
+            RenderOccluders(viewMatrix, projectionMatrix);
+        }
+        InstanceCuller::Pass cullPass = cullingShadows ? InstanceCuller::PASS_SHADOW : InstanceCuller::PASS_MAIN;
+        if (gpuCulling) {
+            if (instanceCuller.Refresh() || cullInstancesDirty) {
+                BuildCullInstances();
+                instanceCuller.SetInstances(cullInstances);
+                cullInstancesDirty = false;
+            }
+            instanceCuller.Cull(cullPass, cullingShadows ? lightFrustum : viewFrustum, cullOrigin, (cullingShadows || !fogCulling) ? 0.0f : FOG_CUTOFF,
+                                lodScale, LOD_PIXEL_ERROR, LOD_HYSTERESIS, !cullingShadows, occlusionPass ? &hiZBuffer : NULL);
+        } else {
+            for(auto& inst : cityBuildings) {
+                glm::mat4 modelMatrix = ModelMatrix(inst.position, inst.rotation, inst.scale);
+                if (inst.type == 0) {
+                    AddInstance(hangarBatch, building, modelMatrix, inst.color, &inst.lod);
+                } else if (inst.type == 1) {
+                    AddInstance(tower1Batch, tower1, modelMatrix, inst.color, &inst.lod);
+                } else if (inst.type == 2) {
+                    AddInstance(tower2Batch, tower2, modelMatrix, inst.color, &inst.lod);
+                }
+            }
+            for(auto& alienInst : alienInstances) {
+                 if (alienInst.type == 0) {
+                     AddInstance(alienBatch, alien, ModelMatrix(alienInst.position, 0.0f, glm::vec3(8.0f)), glm::vec3(0.2f, 0.8f, 0.2f), &alienInst.lod);
+                 } else {
+                     AddInstance(newAlienBatch, newAlien, ModelMatrix(alienInst.position, 0.0f, glm::vec3(12.0f)), glm::vec3(1.0f), &alienInst.lod);
+                 }
+            }
         }
-        for(const auto& b : bullets) {
-             RenderMesh(sun, shader, viewMatrix, projectionMatrix, b.position, b.velocity, glm::vec3(0.5f, 0.5f, 6.0f), glm::vec3(0.0f, 1.0f, 1.0f)); 
+        for (size_t i = 0; i < bullets.Size(); i++) {
+             AddInstance(sunBatch, sun, ModelMatrix(bullets.Position(i), bullets.Velocity(i), glm::vec3(0.5f, 0.5f, 6.0f)), glm::vec3(0.0f, 1.0f, 1.0f));
         }
         if (type == RENDER_ALL) {
              glm::vec3 sunPos = glm::vec3(0.0f, 500.0f, 500.0f); 
-             RenderMesh(sun, shader, viewMatrix, projectionMatrix, sunPos, 0.0f, 30.0f, glm::vec3(1.0f, 1.0f, 0.5f)); 
+             AddInstance(sunBatch, sun, ModelMatrix(sunPos, 0.0f, glm::vec3(30.0f)), glm::vec3(1.0f, 1.0f, 0.5f));
         }
         float time = (float)glfwGetTime();
         for(size_t i=0; i<asteroidPositions.size(); ++i) {
             glm::vec3 pos = asteroidPositions[i]; 
             float tumble = time * 20.0f;
-            RenderMesh(rock, shader, viewMatrix, projectionMatrix, pos, tumble, 20.0f + (i % 10), glm::vec3(0.6f, 0.5f, 0.4f));
+            AddInstance(rockBatch, rock, ModelMatrix(pos, tumble, glm::vec3(20.0f + (i % 10))), glm::vec3(0.6f, 0.5f, 0.4f));
+        }
+        RenderQueue::Pass pass = (type == RENDER_SHADOWS) ? RenderQueue::PASS_SHADOW : RenderQueue::PASS_OPAQUE;
+        renderQueue.Clear();
+        QueueBatch(rock, rockBatch, shader, pass, viewMatrix);
+        QueueBatch(crater, craterBatch, shader, pass, viewMatrix);
+        QueueBatch(building, hangarBatch, shader, pass, viewMatrix);
+        QueueBatch(tower1, tower1Batch, shader, pass, viewMatrix);
+        QueueBatch(tower2, tower2Batch, shader, pass, viewMatrix);
+        QueueBatch(alien, alienBatch, shader, pass, viewMatrix);
+        QueueBatch(newAlien, newAlienBatch, shader, pass, viewMatrix);
+        QueueBatch(sun, sunBatch, shader, pass, viewMatrix);
+        renderQueue.Sort();
+        renderQueue.Execute();
+        if (gpuCulling) {
+            instanceCuller.Draw(cullPass, shader);
         }
         ground.Draw(shader, viewMatrix); 
         if (type == RENDER_ALL) {
@@ -296,19 +721,201 @@ namespace gps {
                           glm::vec3 position, float rotationAngle, float scale, glm::vec3 colorOverride) {
        RenderMesh(mesh, shader, view, projection, position, rotationAngle, glm::vec3(scale), colorOverride);
     }
-    void World::RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
-                          glm::vec3 position, float rotationAngle, glm::vec3 scaleVector, glm::vec3 colorOverride) {
-        shader.useShaderProgram();
-        GLint modelLoc = glGetUniformLocation(shader.shaderProgram, "model");
-        GLint normalMatrixLoc = glGetUniformLocation(shader.shaderProgram, "normalMatrix");
+    glm::mat4 World::ModelMatrix(glm::vec3 position, float rotationAngle, glm::vec3 scaleVector) {
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, position);
         model = glm::rotate(model, glm::radians(rotationAngle), glm::vec3(0, 1, 0));
         model = glm::scale(model, scaleVector);
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        if(normalMatrixLoc >= 0) {
+        return model;
+    }
+    glm::mat4 World::ModelMatrix(glm::vec3 position, glm::vec3 direction, glm::vec3 scaleVector) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, position);
+        glm::vec3 up = glm::vec3(0, 1, 0);
+        if (glm::abs(glm::dot(glm::normalize(direction), up)) > 0.95f) up = glm::vec3(1, 0, 0);
+        glm::mat4 rotation = glm::inverse(glm::lookAt(glm::vec3(0.0f), direction, up));
+        model = model * rotation;
+        model = glm::scale(model, scaleVector);
+        return model;
+    }
+    gps::InstanceData World::MakeInstance(glm::mat4 model, glm::vec3 colorOverride) {
+        gps::InstanceData data;
+        data.model = model;
+        data.color = glm::vec4(colorOverride, colorOverride != glm::vec3(1.0f) ? 1.0f : 0.0f);
+        return data;
+    }
+    void World::AddInstance(ModelBatch& batch, const gps::Model3D& model, glm::mat4 modelMatrix, glm::vec3 colorOverride, int* lodState) {
+        CullStats& stats = cullingShadows ? shadowCullStats : cullStats;
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.boundsCenter, 1.0f));
+        float maxScale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        float radius = model.boundsRadius * maxScale;
+        if (!IsVisible(center, radius)) {
+            stats.culled++;
+            return;
+        }
+        if (lodState != NULL && !cullingShadows && occlusionCulling) {
+            if (hiZBuffer.IsOccluded(model.boundsMin, model.boundsMax, modelMatrix)) {
+                occlusionStats.occluded++;
+                return;
+            }
+            occlusionStats.visible++;
+        }
+        stats.visible++;
+        int lod = SelectLod(model, center, radius, lodState);
+        if (!cullingShadows) {
+            lodStats.instances[lod]++;
+        }
+        batch.lods[lod].push_back(MakeInstance(modelMatrix, colorOverride));
+    }
+    bool World::IsVisible(glm::vec3 center, float radius) const {
+        if (cullingShadows) {
+            return lightFrustum.IntersectsSphere(center, radius);
+        }
+        if (fogCulling && glm::distance(center, cullOrigin) - radius > FOG_CUTOFF) {
+            return false;
+        }
+        return viewFrustum.IntersectsSphere(center, radius);
+    }
+    int World::SelectLod(const gps::Model3D& model, glm::vec3 center, float radius, int* lodState) const {
+        int lodCount = model.LodCount();
+        int lod = lodState ? glm::clamp(*lodState, 0, lodCount - 1) : 0;
+        if (cullingShadows && lodState) {
+            return lod;
+        }
+        float screenRadius = radius / glm::max(glm::distance(center, cullOrigin), 1.0f) * lodScale;
+        while (lod + 1 < lodCount && model.LodError(lod + 1) * screenRadius < LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) {
+            lod++;
+        }
+        while (lod > 0 && model.LodError(lod) * screenRadius > LOD_PIXEL_ERROR * (1.0f + LOD_HYSTERESIS)) {
+            lod--;
+        }
+        if (lodState) {
+            *lodState = lod;
+        }
+        return lod;
+    }
+    void World::QueueBatch(gps::Model3D& model, ModelBatch& batch, gps::Shader& shader, RenderQueue::Pass pass, const glm::mat4& viewMatrix) {
+        glm::vec4 depthRow = glm::vec4(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]);
+        for (int lod = 0; lod < model.LodCount(); lod++) {
+            std::vector<gps::InstanceData>& instances = batch.lods[lod];
+            if (instances.empty()) {
+                continue;
+            }
+            std::sort(instances.begin(), instances.end(), [&depthRow](const gps::InstanceData& a, const gps::InstanceData& b) {
+                return glm::dot(depthRow, a.model[3]) > glm::dot(depthRow, b.model[3]);
+            });
+            float nearestDepth = -glm::dot(depthRow, instances[0].model[3]);
+            GLuint baseInstance = 0;
+            if (RenderQueue::MultiDrawIndirect()) {
+                baseInstance = renderQueue.AddInstances(instances);
+            } else {
+                model.UploadInstances(instances, lod);
+            }
+            std::vector<gps::Mesh>& meshes = model.LodMeshes(lod);
+            for (size_t i = 0; i < meshes.size(); i++) {
+                gps::Mesh& mesh = meshes[i];
+                GLuint texture = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+                unsigned long long key = RenderQueue::MakeKey(pass, shader.shaderProgram, texture, mesh.geometry->id, nearestDepth, SORT_DEPTH_RANGE);
+                renderQueue.Push(key, &shader, &mesh, (GLsizei)instances.size(), baseInstance);
+            }
+        }
+    }
+    void World::RenderOccluders(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix) {
+        ModelBatch* batches[] = { &occluderHangarBatch, &occluderTower1Batch, &occluderTower2Batch };
+        for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+            batches[b]->lods[0].clear();
+        }
+        for (const auto& inst : cityBuildings) {
+            if (glm::distance(inst.position, cullOrigin) > OCCLUDER_DISTANCE) {
+                continue;
+            }
+            glm::mat4 modelMatrix = ModelMatrix(inst.position, inst.rotation, inst.scale);
+            if (inst.type == 0) {
+                AddOccluder(occluderHangarBatch, building, modelMatrix);
+            } else if (inst.type == 1) {
+                AddOccluder(occluderTower1Batch, tower1, modelMatrix);
+            } else if (inst.type == 2) {
+                AddOccluder(occluderTower2Batch, tower2, modelMatrix);
+            }
+        }
+        renderQueue.Clear();
+        QueueBatch(rock, rockBatch, occluderShader, RenderQueue::PASS_OPAQUE, viewMatrix);
+        QueueBatch(building, occluderHangarBatch, occluderShader, RenderQueue::PASS_OPAQUE, viewMatrix);
+        QueueBatch(tower1, occluderTower1Batch, occluderShader, RenderQueue::PASS_OPAQUE, viewMatrix);
+        QueueBatch(tower2, occluderTower2Batch, occluderShader, RenderQueue::PASS_OPAQUE, viewMatrix);
+        renderQueue.Sort();
+        hiZBuffer.BeginOccluders();
+        renderQueue.Execute();
+        hiZBuffer.EndOccluders(projectionMatrix * viewMatrix);
+        renderQueue.Clear();
+    }
+    void World::AddOccluder(ModelBatch& batch, const gps::Model3D& model, glm::mat4 modelMatrix) {
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.boundsCenter, 1.0f));
+        float maxScale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        if (viewFrustum.IntersectsSphere(center, model.boundsRadius * maxScale)) {
+            batch.lods[0].push_back(MakeInstance(modelMatrix, glm::vec3(1.0f)));
+        }
+    }
+    void World::BuildCullInstances() {
+        cullInstances.clear();
+        for (const auto& inst : cityBuildings) {
+            glm::mat4 modelMatrix = ModelMatrix(inst.position, inst.rotation, inst.scale);
+            if (inst.type == 0) {
+                AddCullInstance(building, cullModels[0], modelMatrix, inst.color);
+            } else if (inst.type == 1) {
+                AddCullInstance(tower1, cullModels[1], modelMatrix, inst.color);
+            } else if (inst.type == 2) {
+                AddCullInstance(tower2, cullModels[2], modelMatrix, inst.color);
+            }
+        }
+        for (const auto& alienInst : alienInstances) {
+            if (alienInst.type == 0) {
+                AddCullInstance(alien, cullModels[3], ModelMatrix(alienInst.position, 0.0f, glm::vec3(8.0f)), glm::vec3(0.2f, 0.8f, 0.2f));
+            } else {
+                AddCullInstance(newAlien, cullModels[4], ModelMatrix(alienInst.position, 0.0f, glm::vec3(12.0f)), glm::vec3(1.0f));
+            }
+        }
+    }
+    void World::AddCullInstance(const gps::Model3D& model, GLuint modelIndex, glm::mat4 modelMatrix, glm::vec3 colorOverride) {
+        gps::InstanceData data = MakeInstance(modelMatrix, colorOverride);
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(model.boundsCenter, 1.0f));
+        float maxScale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        gps::CullInstance instance;
+        instance.model = data.model;
+        instance.color = data.color;
+        instance.sphere = glm::vec4(center, model.boundsRadius * maxScale);
+        instance.modelIndex = modelIndex;
+        instance.padding[0] = 0;
+        instance.padding[1] = 0;
+        instance.padding[2] = 0;
+        cullInstances.push_back(instance);
+    }
+    void World::SetFogCulling(bool enabled) {
+        fogCulling = enabled;
+    }
+    void World::SetOcclusionCulling(bool enabled) {
+        occlusionCulling = enabled;
+    }
+    OcclusionStats World::GetOcclusionStats() const {
+        return gpuCulling ? instanceCuller.GetOcclusionStats() : occlusionStats;
+    }
+    CullStats World::GetCullStats() const {
+        return cullStats;
+    }
+    CullStats World::GetShadowCullStats() const {
+        return shadowCullStats;
+    }
+    LodStats World::GetLodStats() const {
+        return lodStats;
+    }
+    void World::RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
+                          glm::vec3 position, float rotationAngle, glm::vec3 scaleVector, glm::vec3 colorOverride) {
+        shader.useShaderProgram();
+        glm::mat4 model = ModelMatrix(position, rotationAngle, scaleVector);
+        shader.setMat4(gps::Shader::UNIFORM_MODEL, model);
+        if(shader.getUniformLocation(gps::Shader::UNIFORM_NORMAL_MATRIX) >= 0) {
             glm::mat3 normMat = glm::mat3(glm::inverseTranspose(view * model));
-            glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normMat));
+            shader.setMat3(gps::Shader::UNIFORM_NORMAL_MATRIX, normMat);
         }
         for(size_t i=0; i<mesh.meshes.size(); ++i) {
             glm::vec3 originalKd = mesh.meshes[i].Kd;
@@ -322,18 +929,11 @@ namespace gps {
     void World::RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
                    glm::vec3 position, glm::vec3 direction, glm::vec3 scaleVector, glm::vec3 colorOverride) {
         shader.useShaderProgram();
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, position);
-        glm::vec3 up = glm::vec3(0, 1, 0);
-        if (glm::abs(glm::dot(glm::normalize(direction), up)) > 0.95f) up = glm::vec3(1, 0, 0);
-        glm::mat4 rotation = glm::inverse(glm::lookAt(glm::vec3(0.0f), direction, up));
-        model = model * rotation;
-        model = glm::scale(model, scaleVector);
-        glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        GLint normalMatrixLoc = glGetUniformLocation(shader.shaderProgram, "normalMatrix");
-        if(normalMatrixLoc >= 0) {
+        glm::mat4 model = ModelMatrix(position, direction, scaleVector);
+        shader.setMat4(gps::Shader::UNIFORM_MODEL, model);
+        if(shader.getUniformLocation(gps::Shader::UNIFORM_NORMAL_MATRIX) >= 0) {
             glm::mat3 normMat = glm::mat3(glm::inverseTranspose(view * model));
-            glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normMat));
+            shader.setMat3(gps::Shader::UNIFORM_NORMAL_MATRIX, normMat);
         }
         for(size_t i=0; i<mesh.meshes.size(); ++i) {
              glm::vec3 originalKd = mesh.meshes[i].Kd;
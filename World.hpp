@@ -8,11 +8,59 @@
 #include "Shader.hpp"
 #include "SkyBox.hpp"
 #include "Ground.hpp"
+#include "Frustum.hpp"
+#include "RenderQueue.hpp"
+#include "InstanceCuller.hpp"
+#include "HiZBuffer.hpp"
+#include "SpatialGrid.hpp"
+#include "BulletPool.hpp"
+#include "SceneBvh.hpp"
+#include "Gjk.hpp"
+#include "UniformBuffers.hpp"
 namespace gps {
     struct Obstacle {
         glm::vec3 position;
         float radius;
     };
+    enum ColliderType {
+        COLLIDER_OBSTACLE,
+        COLLIDER_SPIRE,
+        COLLIDER_BUILDING
+    };
+    struct CollisionProxy {
+        const gps::ConvexHull* hull;
+        glm::mat4 transform;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+    struct Collider {
+        ColliderType type;
+        glm::vec3 position;
+        float radius;
+        float height;
+        CollisionProxy proxy;
+        glm::vec2 gridMin;
+        glm::vec2 gridMax;
+    };
+    struct SweepHit {
+        float time;
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+    enum TargetType {
+        TARGET_BUILDING,
+        TARGET_ALIEN
+    };
+    struct HitTarget {
+        TargetType type;
+        int index;
+        glm::vec3 position;
+        float radius;
+        float height;
+        CollisionProxy proxy;
+        glm::vec2 gridMin;
+        glm::vec2 gridMax;
+    };
     struct PointLight {
         glm::vec3 position;
         glm::vec3 color;
@@ -31,6 +79,12 @@ namespace gps {
         float quadratic;
         int active; 
     };
+    struct LodStats {
+        int instances[gps::Model3D::MAX_LODS];
+    };
+    struct ModelBatch {
+        std::vector<gps::InstanceData> lods[gps::Model3D::MAX_LODS];
+    };
     class World {
     public:
         enum RenderType {
@@ -38,18 +92,59 @@ namespace gps {
             RENDER_SHADOWS
         };
         World();
-        void Init();
+        void Init(gps::AssetLoader& loader);
         void Update(float delta);
+        void CollectLights(gps::LightBlock& lights, glm::mat4 viewMatrix);
         void Draw(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, RenderType type = RENDER_ALL);  
-        bool CheckCollision(glm::vec3 position, float radius);
+        bool SweepSphere(glm::vec3 start, glm::vec3 move, float radius, SweepHit& hit);
         void FireBullet(glm::vec3 position, glm::vec3 direction);
+        void RayCast(const std::vector<gps::Ray>& rays, std::vector<gps::RayHit>& hits) const;
+        gps::RayHit Pick(glm::vec3 origin, glm::vec3 direction, float maxDistance) const;
         void RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
                        glm::vec3 position, float rotationAngle, float scale, glm::vec3 colorOverride = glm::vec3(1.0f));
         void RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
                        glm::vec3 position, float rotationAngle, glm::vec3 scaleVector, glm::vec3 colorOverride = glm::vec3(1.0f));
         void RenderMesh(gps::Model3D &mesh, gps::Shader& shader, glm::mat4 view, glm::mat4 projection, 
                        glm::vec3 position, glm::vec3 direction, glm::vec3 scaleVector, glm::vec3 colorOverride);
+        static glm::mat4 ModelMatrix(glm::vec3 position, float rotationAngle, glm::vec3 scaleVector);
+        static glm::mat4 ModelMatrix(glm::vec3 position, glm::vec3 direction, glm::vec3 scaleVector);
+        static gps::InstanceData MakeInstance(glm::mat4 model, glm::vec3 colorOverride);
+        void SetFogCulling(bool enabled);
+        void SetOcclusionCulling(bool enabled);
+        CullStats GetCullStats() const;
+        CullStats GetShadowCullStats() const;
+        LodStats GetLodStats() const;
+        OcclusionStats GetOcclusionStats() const;
     private:
+        void AddInstance(ModelBatch& batch, const gps::Model3D& model, glm::mat4 modelMatrix, glm::vec3 colorOverride, int* lodState = NULL);
+        bool IsVisible(glm::vec3 center, float radius) const;
+        int SelectLod(const gps::Model3D& model, glm::vec3 center, float radius, int* lodState) const;
+        void QueueBatch(gps::Model3D& model, ModelBatch& batch, gps::Shader& shader, RenderQueue::Pass pass, const glm::mat4& viewMatrix);
+        void BuildCullInstances();
+        void RenderOccluders(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+        void AddOccluder(ModelBatch& batch, const gps::Model3D& model, glm::mat4 modelMatrix);
+        void AddCullInstance(const gps::Model3D& model, GLuint modelIndex, glm::mat4 modelMatrix, glm::vec3 colorOverride);
+        int AddCollider(ColliderType type, glm::vec3 position, float radius, float height);
+        void RemoveCollider(int id);
+        static bool SweepAgainstSphere(glm::vec3 start, glm::vec3 move, glm::vec3 center, float radius, SweepHit& hit);
+        static bool SweepAgainstCylinder(glm::vec3 start, glm::vec3 move, glm::vec3 axis, float radius, float top, SweepHit& hit);
+        static bool SweepAgainstProxy(glm::vec3 start, glm::vec3 move, float radius, const CollisionProxy& proxy, SweepHit& hit);
+        static bool BoundsOverlap(glm::vec3 aMin, glm::vec3 aMax, glm::vec3 bMin, glm::vec3 bMax);
+        static bool ClipToBounds(glm::vec3 start, glm::vec3 move, glm::vec3 boundsMin, glm::vec3 boundsMax, float& enter, float& exit);
+        static glm::vec3 ProxyContactNormal(const CollisionProxy& proxy, glm::vec3 position, glm::vec3 move);
+        static bool ProxyOverlaps(const CollisionProxy& proxy, glm::vec3 position, float radius);
+        static CollisionProxy MakeProxy(const gps::ConvexHull* hull, const glm::mat4& transform);
+        void SetColliderProxy(int id, const CollisionProxy& proxy);
+        void SetTargetProxy(int id, const CollisionProxy& proxy);
+        void RefreshCollisionProxies();
+        int AddTarget(TargetType type, int index, glm::vec3 position, float radius, float height);
+        void RemoveTarget(int id);
+        bool TargetHit(const HitTarget& target, glm::vec3 position) const;
+        bool HitTargets(glm::vec3 position);
+        void DamageTarget(int id);
+        void RefreshRayScene();
+        void RemoveBuilding(int index);
+        void RemoveAlien(int index);
         gps::SkyBox skyBox;
         gps::Shader skyboxShader;
         gps::Ground ground;
@@ -66,25 +161,69 @@ namespace gps {
         glm::vec3 color; 
         int type; 
         int health; 
+        int lod;
+        int collider;
+        int target;
     };
     struct AlienInstance {
         glm::vec3 position;
         int type; 
         int health; 
-    };
-    struct Bullet {
-        glm::vec3 position;
-        glm::vec3 velocity;
-        float life;
+        int lod;
+        int target;
     };
     std::vector<BuildingInstance> cityBuildings;
     std::vector<AlienInstance> alienInstances; 
-    std::vector<Bullet> bullets;
+    gps::BulletPool bullets;
+    std::vector<Collider> colliders;
+    std::vector<int> freeColliders;
+    gps::SpatialGrid collisionGrid;
+    std::vector<int> colliderQuery;
+    std::vector<HitTarget> targets;
+    std::vector<int> freeTargets;
+    gps::SpatialGrid targetGrid;
+    std::vector<int> targetQuery;
+    gps::SceneBvh rayScene;
+    bool raySceneDirty = true;
+    int raySceneModels = 0;
+    int collisionProxyModels = 0;
+    std::vector<gps::Ray> bulletRays;
+    std::vector<gps::RayHit> bulletHits;
     gps::Model3D building;
     gps::Model3D alien;
     gps::Model3D tower1;
     gps::Model3D tower2;
     gps::Model3D newAlien;
+    ModelBatch rockBatch;
+    ModelBatch craterBatch;
+    ModelBatch hangarBatch;
+    ModelBatch tower1Batch;
+    ModelBatch tower2Batch;
+    ModelBatch alienBatch;
+    ModelBatch newAlienBatch;
+    ModelBatch sunBatch;
+    gps::RenderQueue renderQueue;
+    gps::InstanceCuller instanceCuller;
+    std::vector<gps::CullInstance> cullInstances;
+    GLuint cullModels[5];
+    bool gpuCulling = false;
+    bool cullInstancesDirty = true;
+    gps::HiZBuffer hiZBuffer;
+    gps::Shader occluderShader;
+    ModelBatch occluderHangarBatch;
+    ModelBatch occluderTower1Batch;
+    ModelBatch occluderTower2Batch;
+    bool occlusionCulling = true;
+    OcclusionStats occlusionStats = {0, 0};
+    gps::Frustum viewFrustum;
+    gps::Frustum lightFrustum;
+    glm::vec3 cullOrigin;
+    float lodScale = 1.0f;
+    bool cullingShadows = false;
+    bool fogCulling = true;
+    CullStats cullStats = {0, 0};
+    CullStats shadowCullStats = {0, 0};
+    LodStats lodStats = {};
     public:
     gps::Model3D sun; 
     gps::Model3D nitroModel; 
@@ -17,6 +17,9 @@
 #include "Drone.hpp" 
 #include "World.hpp" 
 #include "ParticleSystem.hpp" 
+#include "UniformBuffers.hpp"
+#include "TextureCache.hpp"
+#include "GeometryArena.hpp"
 #include <iostream>
 gps::Window myWindow;
 glm::mat4 model;
@@ -26,10 +29,7 @@ glm::mat3 normalMatrix;
 glm::vec3 lightDir;
 glm::vec3 lightColor;
 GLint modelLoc;
-GLint viewLoc;
-GLint projectionLoc;
 GLint normalMatrixLoc;
-GLint lightDirLoc;
 GLint lightColorLoc;
 gps::Camera myCamera(
     glm::vec3(0.0f, 2.0f, 5.5f),
@@ -39,6 +39,7 @@ GLboolean pressedKeys[1024];
 gps::Drone myPlayerDrone;
 gps::World myWorld;
 gps::ParticleSystem rainSystem;
+gps::UniformBuffers frameUniforms;
 bool rainActive = false;
 float lightAngle = 0.0f;
 gps::Model3D fleetDrone; 
@@ -48,6 +49,7 @@ GLuint shadowMapFBO;
 GLuint depthMapTexture;
 const unsigned int SHADOW_WIDTH = 4096;
 const unsigned int SHADOW_HEIGHT = 4096;
+const double TEXTURE_UPLOAD_BUDGET_MS = 2.0;
 GLenum glCheckError_(const char *file, int line)
 {
 	GLenum errorCode;
@@ -106,6 +108,10 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
         glm::vec3 rayDir = glm::normalize(farPoint - nearPoint);
         myWorld.FireBullet(myPlayerDrone.GetPosition(), rayDir); 
         glm::vec3 targetPoint = nearPoint + rayDir * 1000.0f; 
+        gps::RayHit pick = myWorld.Pick(nearPoint, rayDir, glm::distance(nearPoint, farPoint));
+        if (pick.hit) {
+            targetPoint = pick.point;
+        }
         glm::vec3 fireDir = glm::normalize(targetPoint - myPlayerDrone.GetPosition());
         myWorld.FireBullet(myPlayerDrone.GetPosition(), fireDir);
     }
@@ -141,10 +147,7 @@ void processMovement(float delta) {
     }
     static bool lPressed = false;
     if (pressedKeys[GLFW_KEY_L] && !lPressed) {
-        static bool flashlightOn = true;
-        flashlightOn = !flashlightOn;
-        myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.active"), flashlightOn ? 1 : 0);
+        frameUniforms.lights.spotLight.active = !frameUniforms.lights.spotLight.active;
         lPressed = true;
     }
     if (!pressedKeys[GLFW_KEY_L]) lPressed = false;
@@ -153,25 +156,35 @@ void processMovement(float delta) {
     if (pressedKeys[GLFW_KEY_C] && !cPressed) {
         fogEnabled = !fogEnabled;
         myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "fogActive"), fogEnabled ? 1 : 0);
+        glUniform1i(myBasicShader.getUniformLocation("fogActive"), fogEnabled ? 1 : 0);
+        myWorld.SetFogCulling(fogEnabled);
         cPressed = true;
         std::cout << "Fog Toggled: " << (fogEnabled ? "ON" : "OFF") << std::endl;
     }
     if (!pressedKeys[GLFW_KEY_C]) cPressed = false;
+    static bool oPressed = false;
+    static bool occlusionEnabled = true;
+    if (pressedKeys[GLFW_KEY_O] && !oPressed) {
+        occlusionEnabled = !occlusionEnabled;
+        myWorld.SetOcclusionCulling(occlusionEnabled);
+        oPressed = true;
+        std::cout << "Occlusion culling: " << (occlusionEnabled ? "ON" : "OFF") << std::endl;
+    }
+    if (!pressedKeys[GLFW_KEY_O]) oPressed = false;
     if (pressedKeys[GLFW_KEY_1]) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "isFlat"), 0);
+        glUniform1i(myBasicShader.getUniformLocation("isFlat"), 0);
     }
     if (pressedKeys[GLFW_KEY_2]) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "isFlat"), 0);
+        glUniform1i(myBasicShader.getUniformLocation("isFlat"), 0);
     }
     if (pressedKeys[GLFW_KEY_3]) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         myBasicShader.useShaderProgram();
-        glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "isFlat"), 1);
+        glUniform1i(myBasicShader.getUniformLocation("isFlat"), 1);
     }
     if (pressedKeys[GLFW_KEY_4]) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
@@ -192,13 +205,10 @@ void updateCamera() {
     myCamera.setPosition(newPos);
     myCamera.setTarget(dronePos + forward * 10.0f); 
     view = myCamera.getViewMatrix();
-    myBasicShader.useShaderProgram();
     glm::vec3 lightPos = dronePos + forward * 2.0f; 
     glm::vec3 lightDir = forward;
-    glm::vec3 lightPosEye = glm::vec3(view * glm::vec4(lightPos, 1.0f));
-    glm::vec3 lightDirEye = glm::vec3(view * glm::vec4(lightDir, 0.0f));
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.position"), 1, glm::value_ptr(lightPosEye));
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.direction"), 1, glm::value_ptr(lightDirEye));
+    frameUniforms.lights.spotLight.position = glm::vec3(view * glm::vec4(lightPos, 1.0f));
+    frameUniforms.lights.spotLight.direction = glm::vec3(view * glm::vec4(lightDir, 0.0f));
 }
 void initOpenGLWindow() {
     myWindow.Create(1024, 768, "OpenGL Project - Modular World");
@@ -218,12 +228,21 @@ void initOpenGLState() {
 	glEnable(GL_CULL_FACE); 
 	glCullFace(GL_BACK); 
 	glFrontFace(GL_CCW); 
+    gps::TextureCache::DetectFormats();
+    gps::RenderQueue::DetectMultiDrawIndirect();
 }
 void initModels() {
-    myPlayerDrone.Load("models/nava_noua/13897_Sci-Fi_Fighter_Ship_v1_l1.obj");
-    fleetDrone.LoadModel("models/kenney_space-kit/Models/OBJ format/craft_speederA.obj");
-    myWorld.Init();
+    double loadStart = glfwGetTime();
+    gps::AssetLoader loader;
+    loader.Start();
+    myPlayerDrone.Load("models/nava_noua/13897_Sci-Fi_Fighter_Ship_v1_l1.obj", loader);
+    fleetDrone.LoadModel("models/kenney_space-kit/Models/OBJ format/craft_speederA.obj", loader);
+    myWorld.Init(loader);
     rainSystem.Init(3000, glm::vec3(0, 50, 0), glm::vec3(400.0f, 100.0f, 400.0f));
+    loader.Finish();
+    std::cout << "Assets loaded in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << std::endl;
+    gps::AssetRegistry::LogStats();
+    gps::GeometryArena::LogStats();
 }
 void initShaders() {
 	myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
@@ -235,7 +254,7 @@ void initShaders() {
 void initFBO() {
     glGenFramebuffers(1, &shadowMapFBO);
     glGenTextures(1, &depthMapTexture);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+    gps::GLState::BindTexture(0, GL_TEXTURE_2D, depthMapTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -256,23 +275,21 @@ void initUniforms() {
 	projection = glm::perspective(glm::radians(45.0f),
                                (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().height,
                                0.1f, 2000.0f);
-	projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-	glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));	
-	viewLoc = glGetUniformLocation(myBasicShader.shaderProgram, "view");
-	modelLoc = glGetUniformLocation(myBasicShader.shaderProgram, "model");
-	normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
+	modelLoc = myBasicShader.getUniformLocation(gps::Shader::UNIFORM_MODEL);
+	normalMatrixLoc = myBasicShader.getUniformLocation(gps::Shader::UNIFORM_NORMAL_MATRIX);
 	lightDir = glm::vec3(0.0f, 10.0f, 10.0f); 
-	lightDirLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDir");
-	glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightColor"), 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
-    glUniform1f(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.constant"), 1.0f);
-    glUniform1f(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.linear"), 0.009f);
-    glUniform1f(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.quadratic"), 0.0032f);
-    glUniform1f(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.cutOff"), glm::cos(glm::radians(12.5f)));
-    glUniform1f(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.outerCutOff"), glm::cos(glm::radians(17.5f)));
-    glUniform3fv(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.color"), 1, glm::value_ptr(glm::vec3(1.0f, 0.9f, 0.8f))); 
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "spotLight.active"), 1); 
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "fogActive"), 1); 
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "isFlat"), 0); 
+	frameUniforms.frame.projection = projection;
+	frameUniforms.frame.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    frameUniforms.lights.spotLight.constant = 1.0f;
+    frameUniforms.lights.spotLight.linear = 0.009f;
+    frameUniforms.lights.spotLight.quadratic = 0.0032f;
+    frameUniforms.lights.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    frameUniforms.lights.spotLight.outerCutOff = glm::cos(glm::radians(17.5f));
+    frameUniforms.lights.spotLight.color = glm::vec3(1.0f, 0.9f, 0.8f);
+    frameUniforms.lights.spotLight.active = 1;
+    frameUniforms.Init();
+    glUniform1i(myBasicShader.getUniformLocation("fogActive"), 1); 
+    glUniform1i(myBasicShader.getUniformLocation("isFlat"), 0); 
 }
 void drawObjects(gps::Shader& shader, glm::mat4 viewMatrix, glm::mat4 projectionMatrix) {
     shader.useShaderProgram();
@@ -283,11 +300,10 @@ void renderFleetMember(gps::Shader& shader, glm::vec3 position, float rotationAn
     glm::mat4 modelMatrix = glm::mat4(1.0f);
     modelMatrix = glm::translate(modelMatrix, position);
     modelMatrix = glm::rotate(modelMatrix, glm::radians(rotationAngle), glm::vec3(0, 1, 0));
-    glUniformMatrix4fv(glGetUniformLocation(shader.shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    GLint normLoc = glGetUniformLocation(shader.shaderProgram, "normalMatrix");
-    if(normLoc >= 0) {
+    shader.setMat4(gps::Shader::UNIFORM_MODEL, modelMatrix);
+    if(shader.getUniformLocation(gps::Shader::UNIFORM_NORMAL_MATRIX) >= 0) {
         glm::mat3 normMat = glm::mat3(glm::inverseTranspose(viewMatrix * modelMatrix));
-        glUniformMatrix3fv(normLoc, 1, GL_FALSE, glm::value_ptr(normMat));
+        shader.setMat3(gps::Shader::UNIFORM_NORMAL_MATRIX, normMat);
     }
     for(size_t i=0; i<fleetDrone.meshes.size(); ++i) {
         if(colorOverride != glm::vec3(1.0f)) fleetDrone.meshes[i].Kd = colorOverride;
@@ -295,9 +311,7 @@ void renderFleetMember(gps::Shader& shader, glm::vec3 position, float rotationAn
     }
 }
 void renderScene() {
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    depthMapShader.useShaderProgram();
+    gps::GLState::BindTexture(3, GL_TEXTURE_2D, 0);
     glDisable(GL_CULL_FACE);
     depthMapShader.useShaderProgram();
     glm::vec3 dronePos = myPlayerDrone.GetPosition();
@@ -307,29 +321,30 @@ void renderScene() {
     glm::mat4 lightProjection = glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, 1.0f, 2000.0f); 
     glm::mat4 lightView = glm::lookAt(lightPos, dronePos, glm::vec3(0.0f, 1.0f, 0.0f));
     glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-    glUniformMatrix4fv(glGetUniformLocation(depthMapShader.shaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+    glm::mat4 lightRot = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0, 1, 0));
+    glm::vec3 sunDir = glm::vec3(lightRot * glm::vec4(0.0f, 10.0f, 10.0f, 0.0f)); 
+    sunDir = glm::normalize(sunDir);
+    frameUniforms.frame.view = view;
+    frameUniforms.frame.projection = projection;
+    frameUniforms.frame.lightDir = glm::vec3(view * glm::vec4(sunDir, 0.0f));
+    frameUniforms.shadow.lightSpaceMatrix = lightSpaceMatrix;
+    myWorld.CollectLights(frameUniforms.lights, view);
+    frameUniforms.Upload();
     glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
     glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
     glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_CLAMP);
     myPlayerDrone.Draw(depthMapShader, lightView); 
     renderFleetMember(depthMapShader, glm::vec3(30.0f, 10.0f, 30.0f), 45.0f, glm::vec3(1.0f), lightView);
     renderFleetMember(depthMapShader, glm::vec3(-50.0f, 20.0f, -40.0f), -30.0f, glm::vec3(1.0f), lightView);
     myWorld.Draw(depthMapShader, lightView, lightProjection, gps::World::RENDER_SHADOWS);
+    glDisable(GL_DEPTH_CLAMP);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glm::mat4 lightRot = glm::rotate(glm::mat4(1.0f), glm::radians(lightAngle), glm::vec3(0, 1, 0));
-    glm::vec3 sunDir = glm::vec3(lightRot * glm::vec4(0.0f, 10.0f, 10.0f, 0.0f)); 
-    sunDir = glm::normalize(sunDir);
-    glm::vec3 sunDirEye = glm::vec3(view * glm::vec4(sunDir, 0.0f));
-    glUniform3fv(lightDirLoc, 1, glm::value_ptr(sunDirEye));
-    glUniformMatrix4fv(glGetUniformLocation(myBasicShader.shaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glUniform1i(glGetUniformLocation(myBasicShader.shaderProgram, "shadowMap"), 3);
+    gps::GLState::BindTexture(3, GL_TEXTURE_2D, depthMapTexture);
+    myBasicShader.setSampler(gps::Shader::UNIFORM_SHADOW_MAP, 3);
     myPlayerDrone.Draw(myBasicShader, view); 
     if (myPlayerDrone.GetBoosting()) {
          glm::vec3 dronePos = myPlayerDrone.GetPosition();
@@ -365,12 +380,16 @@ void renderScene() {
              glm::vec3 nearPt = glm::unProject(glm::vec3(winCoords.x, winCoords.y, 0.0f), view, projection, viewport);
              glm::vec3 farPt = glm::unProject(glm::vec3(winCoords.x, winCoords.y, 1.0f), view, projection, viewport);
              glm::vec3 direction = glm::normalize(farPt - nearPt);
+             gps::RayHit pick = myWorld.Pick(nearPt, direction, glm::distance(nearPt, farPt));
+             if (pick.hit) {
+                 direction = glm::normalize(pick.point - myPlayerDrone.GetPosition());
+             }
              myWorld.FireBullet(myPlayerDrone.GetPosition(), direction);
              lastFireTime = currentTime;
         }
     }
     if (rainActive) {
-        rainSystem.Draw(view, projection);
+        rainSystem.Draw();
     }
 }
 void cleanup() {
@@ -391,14 +410,43 @@ int main(int argc, const char * argv[]) {
     setWindowCallbacks();
 	glCheckError();
     double lastTimeStamp = glfwGetTime();
+    double lastStatsTime = lastTimeStamp;
 	while (!glfwWindowShouldClose(myWindow.getWindow())) {
         double currentTimeStamp = glfwGetTime();
         float delta = (float)(currentTimeStamp - lastTimeStamp);
         lastTimeStamp = currentTimeStamp;
+        gps::GLState::ResetStats();
+        gps::RenderQueue::ResetStats();
         processMovement(delta);
         myWorld.Update(delta); 
         updateCamera();
+        gps::TextureStreamer::Update(TEXTURE_UPLOAD_BUDGET_MS);
 	    renderScene();
+        if (currentTimeStamp - lastStatsTime > 1.0) {
+            gps::CullStats stats = myWorld.GetCullStats();
+            gps::CullStats shadowStats = myWorld.GetShadowCullStats();
+            std::cout << "Culling: " << stats.visible << " visible, " << stats.culled << " culled | Shadow casters: "
+                      << shadowStats.visible << " drawn, " << shadowStats.culled << " culled" << std::endl;
+            gps::OcclusionStats occlusionStats = myWorld.GetOcclusionStats();
+            std::cout << "Occlusion: " << occlusionStats.visible << " visible, " << occlusionStats.occluded << " occluded" << std::endl;
+            gps::LodStats lodStats = myWorld.GetLodStats();
+            std::cout << "LOD instances:";
+            for (int lod = 0; lod < gps::Model3D::MAX_LODS; lod++) {
+                std::cout << " " << lodStats.instances[lod];
+            }
+            std::cout << std::endl;
+            gps::DrawStats drawStats = gps::RenderQueue::GetStats();
+            std::cout << "Draw packets/calls: " << drawStats.packets << "/" << drawStats.drawCalls << std::endl;
+            gps::GLStateStats glStats = gps::GLState::GetStats();
+            std::cout << "Binds issued/elided: program " << glStats.program.issued << "/" << glStats.program.elided
+                      << ", VAO " << glStats.vertexArray.issued << "/" << glStats.vertexArray.elided
+                      << ", texture " << glStats.texture.issued << "/" << glStats.texture.elided
+                      << ", sampler " << glStats.sampler.issued << "/" << glStats.sampler.elided << std::endl;
+            if (gps::TextureStreamer::PendingCount() > 0) {
+                std::cout << "Streaming textures: " << gps::TextureStreamer::PendingCount() << " pending" << std::endl;
+            }
+            lastStatsTime = currentTimeStamp;
+        }
 		glfwPollEvents();
 		glfwSwapBuffers(myWindow.getWindow());
 		glCheckError();
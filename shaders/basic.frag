@@ -2,31 +2,38 @@
 in vec4 fPosEye;
 in vec3 fNormalEye;
 in vec2 fTexCoords;
+flat in vec4 fInstanceColor;
 out vec4 fColor;
+#define MAX_POINT_LIGHTS 6
 struct PointLight {
     vec3 position;
     float constant;
+    vec3 color;
     float linear;
     float quadratic;
-    vec3 color;
 };
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
+    vec3 color;
     float constant;
     float linear;
     float quadratic;
-    vec3 color;
     int active;
 };
-uniform mat4 view;
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-uniform PointLight pointLights[6];
-uniform int nrPointLights;
-uniform SpotLight spotLight;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightDir;
+    vec3 lightColor;
+};
+layout(std140) uniform LightData {
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLight;
+    int nrPointLights;
+};
 uniform int fogActive;
 uniform int isFlat;
 uniform sampler2D diffuseTexture;
@@ -113,13 +120,13 @@ void main()
     vec3 viewDir = normalize(-fPosEye.xyz);
     float shadow = calcShadow(fPosLightSpace);
     calcDirLight(normal, viewDir, shadow);
-    for(int i = 0; i < 6; i++) {
+    for(int i = 0; i < MAX_POINT_LIGHTS; i++) {
         if (i >= nrPointLights) break;
         calcPointLight(pointLights[i], normal, viewDir, fPosEye.xyz);
     }
     calcSpotLight(spotLight, normal, viewDir, fPosEye.xyz);
     vec3 ambientFinal = ambientTotal * Ka;
-    vec3 diffuseFinal = diffuseTotal * Kd;
+    vec3 diffuseFinal = diffuseTotal * (fInstanceColor.w > 0.5f ? fInstanceColor.rgb : Kd);
     vec3 specularFinal = specularTotal * Ks;
     if (hasTexture == 1 && isFlat == 0) {
         vec3 texColor = texture(diffuseTexture, fTexCoords).rgb;
@@ -2,20 +2,41 @@
 layout(location=0) in vec3 vPosition;
 layout(location=1) in vec3 vNormal;
 layout(location=2) in vec2 vTexCoords;
+layout(location=3) in mat4 instanceModel;
+layout(location=7) in vec4 instanceColor;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightDir;
+    vec3 lightColor;
+};
+layout(std140) uniform ShadowData {
+    mat4 lightSpaceMatrix;
+};
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat3 normalMatrix;
-uniform mat4 lightSpaceMatrix;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform int isInstanced;
 out vec4 fPosEye;
 out vec3 fNormalEye;
 out vec2 fTexCoords;
 out vec4 fPosLightSpace;
+flat out vec4 fInstanceColor;
 void main() 
 {
-	fPosEye = view * model * vec4(vPosition, 1.0f);
-	fNormalEye = normalize(normalMatrix * vNormal);
+    mat4 modelMatrix = model;
+    mat3 normalMatrixEye = normalMatrix;
+    vec3 position = positionOffset + vPosition * positionScale;
+    fInstanceColor = vec4(0.0f);
+    if (isInstanced == 1) {
+        modelMatrix = instanceModel;
+        normalMatrixEye = mat3(view) * transpose(inverse(mat3(instanceModel)));
+        fInstanceColor = instanceColor;
+    }
+	fPosEye = view * modelMatrix * vec4(position, 1.0f);
+	fNormalEye = normalize(normalMatrixEye * vNormal);
     fTexCoords = vTexCoords;
-    fPosLightSpace = lightSpaceMatrix * model * vec4(vPosition, 1.0f);
-	gl_Position = projection * view * model * vec4(vPosition, 1.0f);
+    fPosLightSpace = lightSpaceMatrix * modelMatrix * vec4(position, 1.0f);
+	gl_Position = projection * view * modelMatrix * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -1,8 +1,16 @@
 #version 410 core
 layout(location=0) in vec3 vPosition;
-uniform mat4 lightSpaceMatrix;
+layout(location=3) in mat4 instanceModel;
+layout(std140) uniform ShadowData {
+    mat4 lightSpaceMatrix;
+};
 uniform mat4 model;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform int isInstanced;
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(vPosition, 1.0f);
+    mat4 modelMatrix = isInstanced == 1 ? instanceModel : model;
+    vec3 position = positionOffset + vPosition * positionScale;
+    gl_Position = lightSpaceMatrix * modelMatrix * vec4(position, 1.0f);
 }
\ No newline at end of file
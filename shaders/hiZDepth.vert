@@ -0,0 +1,19 @@
+#version 410 core
+layout(location=0) in vec3 vPosition;
+layout(location=3) in mat4 instanceModel;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightDir;
+    vec3 lightColor;
+};
+uniform mat4 model;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform int isInstanced;
+void main()
+{
+    mat4 modelMatrix = isInstanced == 1 ? instanceModel : model;
+    vec3 position = positionOffset + vPosition * positionScale;
+    gl_Position = projection * view * modelMatrix * vec4(position, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 410 core
+uniform sampler2D sourceDepth;
+uniform int copyDepth;
+out float depth;
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    if (copyDepth == 1) {
+        depth = texelFetch(sourceDepth, coord, 0).r;
+        return;
+    }
+    ivec2 limit = textureSize(sourceDepth, 0) - 1;
+    ivec2 source = coord * 2;
+    float d0 = texelFetch(sourceDepth, min(source, limit), 0).r;
+    float d1 = texelFetch(sourceDepth, min(source + ivec2(1, 0), limit), 0).r;
+    float d2 = texelFetch(sourceDepth, min(source + ivec2(0, 1), limit), 0).r;
+    float d3 = texelFetch(sourceDepth, min(source + ivec2(1, 1), limit), 0).r;
+    depth = max(max(d0, d1), max(d2, d3));
+}
\ No newline at end of file
@@ -1,7 +1,11 @@
 #version 410 core
 layout (location = 0) in vec3 vertex;
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 lightDir;
+    vec3 lightColor;
+};
 uniform mat4 model;
 void main()
 {